@@ -30,38 +30,165 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <sstream>
 #include <iomanip>
+#include <istream>
+#include <ostream>
 #include <assert.h>
-#include <math.h>
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
 #include <exception>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace VTLimbs;
 
 VTBignum::VTBignum(): _sign(0), _chunks()
-{
-    _chunks.push_back(0);
-}
+{}
 
 VTBignum::VTBignum(const VTBignum& other): _sign(other._sign), _chunks(other._chunks)
 {}
 
-VTBignum& VTBignum::operator=(VTBignum rhs)
+VTBignum& VTBignum::operator=(const VTBignum& rhs)
+{
+    // limbs are copied into the existing buffer when it is big enough
+    _sign = rhs._sign;
+    _chunks = rhs._chunks;
+    return *this;
+}
+
+#if defined(VT_HAS_RVALUE_REFERENCES)
+VTBignum::VTBignum(VTBignum&& other): _sign(other._sign), _chunks(std::move(other._chunks))
+{
+    other._sign = 0;
+}
+
+VTBignum& VTBignum::operator=(VTBignum&& rhs)
 {
-    swap(*this, rhs);
+    _sign = rhs._sign;
+    _chunks = std::move(rhs._chunks);
+    rhs._sign = 0;
     return *this;
 }
+#endif
 
 VTBignum::~VTBignum(void)
 {}
 
+int VTBignum::size() const
+{
+    if (_chunks.empty())
+        return 1;
+
+    int bytes = (limbs() - 1) * LIMB_BYTES;
+    for (limb_t top = _chunks.back(); top != 0; top >>= 8)
+        ++bytes;
+
+    return bytes;
+}
+
 VTBignum VTBignum::fromByteArray(const unsigned char* bytes, int size, int sign)
+{
+    return fromWords(bytes, size, 1, Order_least_first, Endian_little, sign);
+}
+
+VTBignum VTBignum::fromLimbs(const limb_t* limbs, int n, int sign)
 {
     VTBignum bignum = create_empty();
     bignum._sign = ( sign == 0 ? 0 : 1 );
-    bignum._chunks.reserve(size);
+    bignum._chunks.assign(limbs, limbs + n);
+    bignum.normilize();
+    return bignum;
+}
+
+VTBignum VTBignum::fromView(const VTBignumView& view)
+{
+    return fromLimbs(view.data(), view.limbs(), view.sign());
+}
+
+namespace
+{
+    // offset of byte index (0 for the least significant one) of a number
+    // stored in count words of word_size bytes
+    inline int byte_offset(int index, int count, int word_size, VTBignum::WordOrder order, bool big_endian)
+    {
+        int word = index / word_size;
+        int byte = index % word_size;
+        if (order == VTBignum::Order_most_first)
+            word = count - 1 - word;
+        if (big_endian)
+            byte = word_size - 1 - byte;
+        return word * word_size + byte;
+    }
+
+    // limb from LIMB_BYTES bytes, most significant first
+    inline limb_t load_big(const unsigned char* bytes)
+    {
+        limb_t limb = 0;
+        for (int i = 0; i < LIMB_BYTES; ++i)
+            limb = (limb << 8) | bytes[i];
+        return limb;
+    }
 
-    for (int i = 0; i < size; ++i)
+    inline void store_big(unsigned char* bytes, limb_t limb)
     {
-        bignum._chunks.push_back(bytes[i]);
+        for (int i = LIMB_BYTES - 1; i >= 0; --i, limb >>= 8)
+            bytes[i] = static_cast<unsigned char>(limb);
+    }
+}
+
+/*
+    Words laid out as one little-endian byte string (least significant word
+    first, little-endian words) are the limbs themselves on little-endian
+    machines and are copied with memcpy; one big-endian string is read back
+    to front a limb at a time. Other layouts go byte by byte.
+*/
+VTBignum VTBignum::fromWords(const void* words, int count, int word_size, WordOrder order, Endian endian, int sign)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(words);
+    int size = count * word_size;
+    bool big_endian = (endian == Endian_big || (endian == Endian_native && !little_endian()));
+
+    VTBignum bignum = create_empty();
+    bignum._sign = ( sign == 0 ? 0 : 1 );
+    int n = (size + LIMB_BYTES - 1) / LIMB_BYTES;
+    bignum._chunks.resize(n);
+    if (n == 0)
+        return bignum;
+    limb_t* limbs = &bignum._chunks[0];
+    limbs[n - 1] = 0;
+
+    bool little_string = (order == Order_least_first || count == 1) && (!big_endian || word_size == 1);
+    bool big_string = (order == Order_most_first || count == 1) && (big_endian || word_size == 1);
+    if (little_string && little_endian())
+    {
+        memcpy(limbs, bytes, size);
+    }
+    else if (big_string)
+    {
+        int whole = size / LIMB_BYTES;
+        for (int i = 0; i < whole; ++i)
+            limbs[i] = load_big(bytes + size - (i + 1) * LIMB_BYTES);
+        for (int i = whole * LIMB_BYTES; i < size; ++i)
+            limbs[whole] |= static_cast<limb_t>(bytes[size - 1 - i]) << (8 * (i % LIMB_BYTES));
+    }
+    else
+    {
+        std::fill(limbs, limbs + n, 0);
+        for (int i = 0; i < size; ++i)
+        {
+            limb_t byte = bytes[byte_offset(i, count, word_size, order, big_endian)];
+            limbs[i / LIMB_BYTES] |= byte << (8 * (i % LIMB_BYTES));
+        }
     }
 
+    bignum.normilize();
     return bignum;
 }
 
@@ -78,432 +205,2147 @@ VTBignum VTBignum::fromLongLong(long long value)
     VTBignum bignum = create_empty();
 
     bignum._sign = (value < 0 ? 1 : 0);
-    long long overflow = (value < 0 ? -value : value);
+    // negate in unsigned arithmetic, so that LLONG_MIN does not overflow
+    limb_t magnitude = static_cast<limb_t>(value);
+    if (value < 0)
+        magnitude = 0 - magnitude;
+
+    bignum._chunks.push_back(magnitude);
+
+    return bignum;
+}
+
+/*
+    Powers chunk^(2^k), where chunk is the biggest power of base that fits
+    into a limb, used by radix conversion in both directions.
+    Numbers below power k have at most chunk_digits * 2^k digits, and
+    the number being converted is below the square of the last power,
+    level powers.size().
+*/
+struct VTBignum::PowerTree
+{
+    // powers for printing numbers up to limit, with reciprocals of the long ones
+    PowerTree(int radix, const VTBignum& limit): base(radix), chunk(radix), chunk_digits(1)
+    {
+        init_chunk();
+        grow();
+        // square of n limbs long power has at least 2n - 1 limbs
+        while (limit.limbs() >= 2 * powers.back().limbs() - 1)
+            grow();
+
+        // long powers are divided by many times, keep their reciprocals
+        shifts.resize(powers.size(), 0);
+        normalized.resize(powers.size());
+        inverses.resize(powers.size());
+        for (size_t k = 0; k < powers.size(); ++k)
+        {
+            if (powers[k].limbs() < thresholds.div_newton)
+                continue;
+
+            shifts[k] = count_leading_zeros(powers[k]._chunks.back());
+            normalized[k] = powers[k];
+            normalized[k].shift_left(shifts[k]);
+            inverses[k] = reciprocal(normalized[k]);
+        }
+    }
 
-    while (overflow > 0)
+    // powers for parsing digits digits, the top level powers.size() covers all of them
+    PowerTree(int radix, int digits): base(radix), chunk(radix), chunk_digits(1)
     {
-        bignum._chunks.push_back(overflow % 256);
-        overflow = overflow / 256;
+        init_chunk();
+        // short inputs are read in one go, without powers
+        if (digits / chunk_digits < thresholds.str_dc)
+            return;
+        while (width(static_cast<int>(powers.size())) < digits)
+            grow();
     }
 
-    return bignum;
+    void init_chunk()
+    {
+        while (chunk <= LIMB_MAX / base)
+        {
+            chunk *= base;
+            ++chunk_digits;
+        }
+    }
+
+    // add the next power, chunk or the square of the last one
+    void grow()
+    {
+        if (powers.empty())
+        {
+            VTBignum power = create_empty();
+            power._chunks.push_back(chunk);
+            powers.push_back(power);
+        }
+        else
+        {
+            powers.push_back(powers.back() * powers.back());
+        }
+    }
+
+    // number of digits written for level k
+    inline int width(int level) const { return chunk_digits << level; }
+
+    int base;
+    limb_t chunk;
+    int chunk_digits;
+    std::vector<VTBignum> powers;
+
+    // for powers long enough for Newton division, empty otherwise
+    std::vector<int> shifts;
+    std::vector<VTBignum> normalized;
+    std::vector<VTBignum> inverses;
+};
+
+/*
+    Digits on their way out: digit values are turned into characters and
+    collected in a small buffer, which is handed to write whenever it fills
+    up. Leading zeros are dropped, zero is written as a single digit.
+    Raw sinks keep digit values, for bases above 16; upper case sinks write
+    the digits above 9 as capitals.
+*/
+struct VTBignum::DigitSink
+{
+    typedef void (*Write)(void* target, const char* text, int size);
+
+    DigitSink(Write write_text, void* text_target, bool raw_values, bool upper_case = false)
+        : write(write_text), target(text_target), raw(raw_values), upper(upper_case), started(false), size(0)
+    {}
+
+    void put(const char* digits, int count)
+    {
+        int i = 0;
+        while (!started && i < count && digits[i] == 0)
+            ++i;
+        if (i < count)
+            started = true;
+
+        for (/* none */; i < count; ++i)
+        {
+            if (size == CAPACITY)
+                flush();
+            text[size++] = (raw ? digits[i] : (upper ? "0123456789ABCDEF" : "0123456789abcdef")[static_cast<int>(digits[i])]);
+        }
+    }
+
+    void zeros(int count)
+    {
+        if (!started)
+            return;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (size == CAPACITY)
+                flush();
+            text[size++] = (raw ? 0 : '0');
+        }
+    }
+
+    // write out the rest, a single zero if there were only zeros
+    void finish()
+    {
+        if (!started)
+        {
+            started = true;
+            zeros(1);
+        }
+        flush();
+    }
+
+    void flush()
+    {
+        if (size > 0)
+            write(target, text, size);
+        size = 0;
+    }
+
+    enum {CAPACITY = 1 << 14};
+
+    Write write;
+    void* target;
+    bool raw;
+    bool upper;
+    bool started;   // a non-zero digit was put
+    int size;
+    char text[CAPACITY];
+};
+
+namespace
+{
+    // digits are read in blocks of the power tree width at this level
+    const int TEXT_BLOCK_LEVEL = 12;
+
+    int read_fd(int fd, char* buffer, int size)
+    {
+        int n;
+        do
+        {
+#if defined(_WIN32)
+            n = _read(fd, buffer, size);
+#else
+            n = static_cast<int>(read(fd, buffer, size));
+#endif
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+            throw std::runtime_error("Failed to read number");
+        return n;
+    }
+
+    // DigitSink targets
+
+    void append_string(void* target, const char* text, int size)
+    {
+        static_cast<std::string*>(target)->append(text, size);
+    }
+
+    void write_stream(void* target, const char* text, int size)
+    {
+        static_cast<std::ostream*>(target)->write(text, size);
+    }
+
+    void write_file(void* target, const char* text, int size)
+    {
+        if (fwrite(text, 1, size, static_cast<FILE*>(target)) != static_cast<size_t>(size))
+            throw std::runtime_error("Failed to write number");
+    }
+
+    void write_fd(void* target, const char* text, int size)
+    {
+        int fd = *static_cast<int*>(target);
+        while (size > 0)
+        {
+#if defined(_WIN32)
+            int n = _write(fd, text, size);
+#else
+            int n = static_cast<int>(write(fd, text, size));
+#endif
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error("Failed to write number");
+            text += n;
+            size -= n;
+        }
+    }
+
+    // sources for read_text: peek() returns the next character or EOF, next() skips it
+
+    // the character after the number stays in the stream
+    struct StreamText
+    {
+        explicit StreamText(std::streambuf* stream): buffer(stream) {}
+
+        inline int peek()
+        {
+            std::streambuf::int_type c = buffer->sgetc();
+            return ( std::streambuf::traits_type::eq_int_type(c, std::streambuf::traits_type::eof()) ? EOF : c );
+        }
+        inline void next() { buffer->sbumpc(); }
+
+        std::streambuf* buffer;
+    };
+
+    struct FileText
+    {
+        explicit FileText(FILE* input): file(input), current(EOF), peeked(false) {}
+
+        inline int peek()
+        {
+            if (!peeked)
+                current = getc(file);
+            peeked = true;
+            return current;
+        }
+        inline void next() { peeked = false; }
+
+        // put back the character after the number
+        void finish()
+        {
+            if (peeked && current != EOF)
+                ungetc(current, file);
+            peeked = false;
+        }
+
+        FILE* file;
+        int current;
+        bool peeked;
+    };
+
+    struct FdText
+    {
+        explicit FdText(int input): fd(input), pos(0), size(0) {}
+
+        inline int peek()
+        {
+            if (pos == size)
+            {
+                pos = 0;
+                size = read_fd(fd, buffer, sizeof(buffer));
+                if (size == 0)
+                    return EOF;
+            }
+            return static_cast<unsigned char>(buffer[pos]);
+        }
+        inline void next() { ++pos; }
+
+        int fd;
+        int pos;
+        int size;
+        char buffer[1 << 16];
+    };
+
+    template <class Text>
+    void skip_space(Text& text)
+    {
+        while (text.peek() != EOF && isspace(text.peek()))
+            text.next();
+    }
 }
 
 VTBignum VTBignum::fromString(const char* char_array, int size, Base base)
 {
     assert(base == Base_10 || base == Base_16);
+    VT_STAT_OPERATION(Stat_from_string, 0);
+
+    // stop at the terminating null, if there is one before size characters
+    int length = 0;
+    while ((size < 0 || length < size) && char_array[length] != '\0')
+        ++length;
+
+    int i = 0;
+    char sign = 0;
+    if (length > 0 && char_array[0] == '-')
+    {
+        sign = 1;
+        ++i;
+    }
+    else if (length > 0 && char_array[0] == '+')
+    {
+        sign = 0;
+        ++i;
+    }
+
+    const char* digits = char_array + i;
+    int count = length - i;
+    for (int k = 0; k < count; ++k)
+    {
+        if (digit_value(digits[k]) >= base)
+            throw std::runtime_error("Wrong character in number");
+    }
+
     VTBignum bignum = create_empty();
+    if (base == Base_16)
+    {
+        // every hex digit is a nibble of the result, no arithmetic needed
+        bignum._chunks.assign((count + 2 * LIMB_BYTES - 1) / (2 * LIMB_BYTES), 0);
+        for (int k = 0; k < count; ++k)
+        {
+            int nibble = count - 1 - k;
+            bignum._chunks[nibble / (2 * LIMB_BYTES)] |= static_cast<limb_t>(digit_value(digits[k])) << (4 * (nibble % (2 * LIMB_BYTES)));
+        }
+    }
+    else if (count > 0)
+    {
+        VT_STAT_TIER(Stat_radix_conversion);
+        PowerTree tree(base, count);
+        bignum = read_digits(digits, count, static_cast<int>(tree.powers.size()), tree);
+    }
+
+    bignum._sign = sign;
+    bignum.normilize();
+    VT_STAT_LIMBS(bignum.limbs());
+    return bignum;
+}
+
+char VTBignum::toByteArray(unsigned char* bytes) const
+{
+    return toWords(bytes, size(), 1, Order_least_first, Endian_little);
+}
+
+int VTBignum::words(int word_size) const
+{
+    if (limbs() == 0)
+        return 0;
+    return (size() + word_size - 1) / word_size;
+}
+
+char VTBignum::toWords(void* words, int count, int word_size, WordOrder order, Endian endian) const
+{
+    if (this->words(word_size) > count)
+        throw std::runtime_error("Number does not fit the words");
+
+    unsigned char* bytes = static_cast<unsigned char*>(words);
+    int size = count * word_size;
+    int used = std::min(size, limbs() * LIMB_BYTES);
+    bool big_endian = (endian == Endian_big || (endian == Endian_native && !little_endian()));
+
+    bool little_string = (order == Order_least_first || count == 1) && (!big_endian || word_size == 1);
+    bool big_string = (order == Order_most_first || count == 1) && (big_endian || word_size == 1);
+    if (little_string && little_endian())
+    {
+        if (used > 0)
+            memcpy(bytes, &_chunks[0], used);
+        memset(bytes + used, 0, size - used);
+    }
+    else if (big_string)
+    {
+        int whole = used / LIMB_BYTES;
+        for (int i = 0; i < whole; ++i)
+            store_big(bytes + size - (i + 1) * LIMB_BYTES, _chunks[i]);
+        for (int i = whole * LIMB_BYTES; i < size; ++i)
+            bytes[size - 1 - i] = static_cast<unsigned char>(limb(i / LIMB_BYTES) >> (8 * (i % LIMB_BYTES)));
+    }
+    else
+    {
+        for (int i = 0; i < size; ++i)
+            bytes[byte_offset(i, count, word_size, order, big_endian)] = static_cast<unsigned char>(limb(i / LIMB_BYTES) >> (8 * (i % LIMB_BYTES)));
+    }
+    return _sign;
+}
+
+long long VTBignum::toLongLong() const
+{
+    if (limbs() == 0)
+        return 0;
+
+    const limb_t max_magnitude = static_cast<limb_t>(1) << (LIMB_BITS - 1);    // one bit is needed for sign in signed long long
+
+    if (limbs() > 1)
+        throw std::runtime_error("Number is too big for long long");
+    else if (_chunks[0] > max_magnitude || (_chunks[0] == max_magnitude && _sign == 0))
+        throw std::runtime_error("Number is too big for long long");
+
+    limb_t result = _chunks[0];
+
+    if (_sign == 1)
+        result = 0 - result;
+
+    return static_cast<long long>(result);
+}
+
+std::string VTBignum::toString(int base) const
+{
+    assert(base > 1 && base <= 256);
+    VT_STAT_OPERATION(Stat_to_string, limbs());
+
+    if (limbs() == 0)
+        return std::string("0");
+
+    if (base == 16)
+    {
+        // two hex digits per byte, no conversion needed
+        static const char characters[] = "0123456789abcdef";
+        int bytes = size();
+        std::string result(_sign + 2 * bytes, '-');
+        char* out = &result[_sign];
+        for (int i = 0; i < bytes; ++i)
+        {
+            unsigned char byte = static_cast<unsigned char>(_chunks[i / LIMB_BYTES] >> (8 * (i % LIMB_BYTES)));
+            out[2 * (bytes - 1 - i)] = characters[byte >> 4];
+            out[2 * (bytes - 1 - i) + 1] = characters[byte & 0x0f];
+        }
+        return result;
+    }
+
+    if (base == 256)
+    {
+        std::vector<unsigned char> digits;
+        digits.reserve(size());
+        for (int i = 0; i < size(); ++i)
+            digits.push_back( static_cast<unsigned char>(_chunks[i / LIMB_BYTES] >> (8 * (i % LIMB_BYTES))) );
+
+        return print(digits, base, _sign);
+    }
+
+    // digit values are streamed into the result
+    std::string result(base <= 16 && _sign == 1 ? "-" : "");
+    DigitSink sink(append_string, &result, base > 16);
+    write_text(sink, base);
+    if (base <= 16)
+        return result;
+
+    // digits bigger than 16 are printed as separate numbers
+    std::vector<unsigned char> digits(result.rbegin(), result.rend());
+    return print(digits, base, _sign);
+}
+
+void VTBignum::write_to(FILE* file, int base) const
+{
+    assert(base > 1 && base <= 16);
+    VT_STAT_OPERATION(Stat_to_string, limbs());
+
+    if (_sign == 1)
+        write_file(file, "-", 1);
+    DigitSink sink(write_file, file, false);
+    write_text(sink, base);
+}
+
+void VTBignum::write_to(int fd, int base) const
+{
+    assert(base > 1 && base <= 16);
+    VT_STAT_OPERATION(Stat_to_string, limbs());
+
+    if (_sign == 1)
+        write_fd(&fd, "-", 1);
+    DigitSink sink(write_fd, &fd, false);
+    write_text(sink, base);
+}
+
+void VTBignum::write_text(DigitSink& out, int base) const
+{
+    if (base == 16)
+    {
+        // nibbles of the limbs, no conversion needed
+        char nibbles[2 * LIMB_BYTES];
+        for (int i = limbs() - 1; i >= 0; --i)
+        {
+            for (int k = 0; k < 2 * LIMB_BYTES; ++k)
+                nibbles[k] = static_cast<char>((_chunks[i] >> (LIMB_BITS - 4 - 4 * k)) & 0x0f);
+            out.put(nibbles, 2 * LIMB_BYTES);
+        }
+    }
+    else if (limbs() > 0)
+    {
+        VT_STAT_TIER(Stat_radix_conversion);
+        PowerTree tree(base, *this);
+        write_digits(*this, static_cast<int>(tree.powers.size()), tree, out);
+    }
+    out.finish();
+}
+
+/*
+    Digits are collected in blocks of the power tree width at TEXT_BLOCK_LEVEL
+    and every block is converted on its own. Converted blocks are combined
+    like the bits of a binary counter: two numbers of the same width are
+    merged into one of twice the width, so that the multiplications stay
+    balanced as in read_digits, while only a block of text is in memory.
+*/
+template <class Text>
+bool VTBignum::read_text(Text& text, int base, VTBignum& result)
+{
+    VT_STAT_OPERATION(Stat_from_string, 0);
+    char sign = 0;
+    if (text.peek() == '-' || text.peek() == '+')
+    {
+        sign = ( text.peek() == '-' ? 1 : 0 );
+        text.next();
+    }
+
+    bool found = false;
+    VTBignum number = create_empty();
+    if (base == 16)
+    {
+        // every hex digit is a nibble, limbs come most significant first
+        std::vector<limb_t> high_first;
+        limb_t limb = 0;
+        int nibbles = 0;
+        for (int c = text.peek(); c != EOF && digit_value(static_cast<char>(c)) < 16; c = text.peek())
+        {
+            found = true;
+            limb = (limb << 4) | static_cast<limb_t>(digit_value(static_cast<char>(c)));
+            text.next();
+            if (++nibbles == 2 * LIMB_BYTES)
+            {
+                high_first.push_back(limb);
+                limb = 0;
+                nibbles = 0;
+            }
+        }
+
+        if (!high_first.empty())
+        {
+            number._chunks.assign(&high_first[0], &high_first[0] + high_first.size());
+            std::reverse(number._chunks.begin(), number._chunks.end());
+        }
+        number.normilize();
+        number.shift_left(4 * nibbles);
+        number.add_no_sign(VTBignumView(&limb, 1));
+    }
+    else
+    {
+        // powers are grown only as far as the input needs them
+        VT_STAT_TIER(Stat_radix_conversion);
+        PowerTree tree(base, 0);
+        std::vector<char> block(tree.width(TEXT_BLOCK_LEVEL));
+        std::vector<VTBignum> values;   // converted blocks, the most significant first
+        std::vector<int> levels;        // values[i] has tree.width(TEXT_BLOCK_LEVEL + levels[i]) digits
+        int count = 0;
+        for (int c = text.peek(); c != EOF && digit_value(static_cast<char>(c)) < base; c = text.peek())
+        {
+            found = true;
+            block[count++] = static_cast<char>(c);
+            text.next();
+            if (count < static_cast<int>(block.size()))
+                continue;
+
+            while (static_cast<int>(tree.powers.size()) < TEXT_BLOCK_LEVEL)
+                tree.grow();
+            values.push_back(read_digits(&block[0], count, TEXT_BLOCK_LEVEL, tree));
+            levels.push_back(0);
+            count = 0;
+
+            for (size_t n = values.size(); n >= 2 && levels[n - 1] == levels[n - 2]; --n)
+            {
+                int level = TEXT_BLOCK_LEVEL + levels[n - 1];
+                while (static_cast<int>(tree.powers.size()) <= level)
+                    tree.grow();
+                values[n - 2] *= tree.powers[level];
+                values[n - 2].add_no_sign(values[n - 1]);
+                values.pop_back();
+                levels.pop_back();
+                ++levels.back();
+            }
+        }
+
+        // the last block is short, the rest are shifted past it one by one from the least significant
+        int level = 0;
+        while (tree.width(level) < count)
+            ++level;
+        while (static_cast<int>(tree.powers.size()) < level)
+            tree.grow();
+        number = read_digits(&block[0], count, level, tree);
+
+        VTBignum power = fromInt(base);
+        power.pow(count);
+        for (int i = static_cast<int>(values.size()) - 1; i >= 0; --i)
+        {
+            values[i] *= power;
+            values[i].add_no_sign(number);
+            swap(number, values[i]);
+
+            if (i > 0)
+            {
+                level = TEXT_BLOCK_LEVEL + levels[i];
+                while (static_cast<int>(tree.powers.size()) <= level)
+                    tree.grow();
+                power *= tree.powers[level];
+            }
+        }
+    }
+
+    if (!found)
+        return false;
+
+    number._sign = sign;
+    number.normilize();
+    swap(result, number);
+    return true;
+}
+
+VTBignum VTBignum::read_from(FILE* file, int base)
+{
+    assert(base > 1 && base <= 16);
+
+    FileText text(file);
+    skip_space(text);
+    VTBignum result;
+    bool found = read_text(text, base, result);
+    text.finish();
+
+    if (ferror(file))
+        throw std::runtime_error("Failed to read number");
+    if (!found)
+        throw std::runtime_error("Wrong character in number");
+    return result;
+}
+
+VTBignum VTBignum::read_from(int fd, int base)
+{
+    assert(base > 1 && base <= 16);
+
+    FdText text(fd);
+    skip_space(text);
+    VTBignum result;
+    bool found = read_text(text, base, result);
+    skip_space(text);
+
+    if (!found || text.peek() != EOF)
+        throw std::runtime_error("Wrong character in number");
+    return result;
+}
+
+std::ostream& operator<<(std::ostream& out, const VTBignum& bignum)
+{
+    std::ostream::sentry sentry(out);
+    if (!sentry)
+        return out;
+
+    // like the built-in inserters: the width is used up, padding goes left, right or after the prefix
+    std::streamsize width = out.width(0);
+    std::ios_base::fmtflags flags = out.flags();
+    std::ios_base::fmtflags basefield = flags & std::ios_base::basefield;
+    std::ios_base::fmtflags adjustfield = flags & std::ios_base::adjustfield;
+    int base = ( basefield == std::ios_base::hex ? 16 : (basefield == std::ios_base::oct ? 8 : 10) );
+    bool upper_case = ( (flags & std::ios_base::uppercase) != 0 );
+
+    std::string prefix = ( bignum._sign == 1 ? "-" : "" );
+    if ((flags & std::ios_base::showbase) && base != 10 && bignum.limbs() > 0)
+        prefix += ( base == 8 ? "0" : (upper_case ? "0X" : "0x") );
+
+    VT_STAT_OPERATION(Stat_to_string, bignum.limbs());
+    // the digits are only held in memory when they have to be counted for padding
+    std::string digits;
+    if (width > 0)
+    {
+        VTBignum::DigitSink sink(append_string, &digits, false, upper_case);
+        bignum.write_text(sink, base);
+    }
+    std::streamsize padding = width - static_cast<std::streamsize>(prefix.size() + digits.size());
+
+    if (adjustfield != std::ios_base::left && adjustfield != std::ios_base::internal)
+        for (; padding > 0; --padding)
+            out.put(out.fill());
+    out.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+    if (adjustfield == std::ios_base::internal)
+        for (; padding > 0; --padding)
+            out.put(out.fill());
+    if (width > 0)
+    {
+        out.write(digits.data(), static_cast<std::streamsize>(digits.size()));
+    }
+    else
+    {
+        VTBignum::DigitSink sink(write_stream, &out, false, upper_case);
+        bignum.write_text(sink, base);
+    }
+    for (; padding > 0; --padding)
+        out.put(out.fill());
+    return out;
+}
+
+std::istream& operator>>(std::istream& in, VTBignum& bignum)
+{
+    // skips white space, unless std::noskipws
+    std::istream::sentry sentry(in);
+    if (!sentry)
+        return in;
+
+    std::ios_base::fmtflags basefield = in.flags() & std::ios_base::basefield;
+    int base = ( basefield == std::ios_base::hex ? 16 : (basefield == std::ios_base::oct ? 8 : 10) );
+
+    StreamText text(in.rdbuf());
+    if (!VTBignum::read_text(text, base, bignum))
+        in.setstate(std::ios_base::failbit);
+    if (text.peek() == EOF)
+        in.setstate(std::ios_base::eofbit);
+    return in;
+}
+
+VTBignum& VTBignum::operator+=(const VTBignum &rhs)
+{
+    VT_STAT_OPERATION(Stat_add, limbs() + rhs.limbs());
+
+    // adding negative to positive is subtraction of magnitudes
+    if (_sign != rhs._sign)
+        sub_no_sign(rhs);
+    else
+        add_no_sign(rhs);
+
+    return *this;
+}
+
+VTBignum operator+(const VTBignum& lhs, const VTBignum& rhs)
+{
+    // room for the carry, so that the sum is not reallocated
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result = lhs;
+    result += rhs;
+    return result;
+}
+
+VTBignum& VTBignum::operator-=(const VTBignum &rhs)
+{
+    VT_STAT_OPERATION(Stat_sub, limbs() + rhs.limbs());
+
+    // subtracting negative from positive is addition of magnitudes
+    if (_sign != rhs._sign)
+        add_no_sign(rhs);
+    else
+        sub_no_sign(rhs);
+
+    return *this;
+}
+
+VTBignum operator-(const VTBignum& lhs, const VTBignum& rhs)
+{
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result = lhs;
+    result -= rhs;
+    return result;
+}
+
+VTBignum& VTBignum::operator*=(const VTBignum &rhs)
+{
+    multiply(*this, rhs, *this);
+    return *this;
+}
+
+VTBignum& VTBignum::operator+=(const VTBignumView& rhs)
+{
+    VT_STAT_OPERATION(Stat_add, limbs() + rhs.limbs());
+    if (_sign != rhs.sign())
+        sub_no_sign(rhs);
+    else
+        add_no_sign(rhs);
+
+    return *this;
+}
+
+VTBignum& VTBignum::operator-=(const VTBignumView& rhs)
+{
+    VT_STAT_OPERATION(Stat_sub, limbs() + rhs.limbs());
+    if (_sign != rhs.sign())
+        add_no_sign(rhs);
+    else
+        sub_no_sign(rhs);
+
+    return *this;
+}
+
+VTBignum& VTBignum::operator*=(const VTBignumView& rhs)
+{
+    multiply(*this, rhs, *this);
+    return *this;
+}
+
+VTBignum& VTBignum::sqr()
+{
+    multiply(*this, *this, *this);
+    return *this;
+}
+
+VTBignum::Product operator*(const VTBignum& lhs, const VTBignum& rhs)
+{
+    return VTBignum::Product(lhs, rhs);
+}
+
+VTBignum::Product::operator VTBignum() const
+{
+    VTBignum result;
+    multiply(a, b, result);
+    return result;
+}
+
+VTBignum& VTBignum::operator=(const Product& product)
+{
+    multiply(product.a, product.b, *this);
+    return *this;
+}
+
+VTBignum& VTBignum::operator+=(const Product& product)
+{
+    add_product(product.a, product.b, false);
+    return *this;
+}
+
+VTBignum& VTBignum::operator-=(const Product& product)
+{
+    add_product(product.a, product.b, true);
+    return *this;
+}
+
+VTBignum operator+(const VTBignum::Product& lhs, const VTBignum& rhs)
+{
+    VTBignum result(rhs);
+    result += lhs;
+    return result;
+}
+
+VTBignum operator+(const VTBignum& lhs, const VTBignum::Product& rhs)
+{
+    VTBignum result(lhs);
+    result += rhs;
+    return result;
+}
+
+VTBignum operator+(const VTBignum::Product& lhs, const VTBignum::Product& rhs)
+{
+    VTBignum result;
+    result = lhs;
+    result += rhs;
+    return result;
+}
+
+VTBignum operator-(const VTBignum::Product& lhs, const VTBignum& rhs)
+{
+    // a * b - c == -(c - a * b)
+    VTBignum result(rhs);
+    result -= lhs;
+    return -result;
+}
+
+VTBignum operator-(const VTBignum& lhs, const VTBignum::Product& rhs)
+{
+    VTBignum result(lhs);
+    result -= rhs;
+    return result;
+}
+
+VTBignum operator-(const VTBignum::Product& lhs, const VTBignum::Product& rhs)
+{
+    VTBignum result;
+    result = lhs;
+    result -= rhs;
+    return result;
+}
+
+VTBignum& VTBignum::operator/=(const VTBignum &rhs)
+{
+    VTBignum remainder;
+    divmod(*this, rhs, *this, remainder);
+    return *this;
+}
+
+VTBignum operator/(const VTBignum& lhs, const VTBignum& rhs)
+{
+    VTBignum quotient, remainder;
+    VTBignum::divmod(lhs, rhs, quotient, remainder);
+    return quotient;
+}
+
+VTBignum& VTBignum::operator%=(const VTBignum &rhs)
+{
+    VTBignum quotient;
+    divmod(*this, rhs, quotient, *this);
+    return *this;
+}
+
+VTBignum operator%(const VTBignum& lhs, const VTBignum& rhs)
+{
+    VTBignum quotient, remainder;
+    VTBignum::divmod(lhs, rhs, quotient, remainder);
+    return remainder;
+}
+
+#if defined(VT_HAS_RVALUE_REFERENCES)
+VTBignum operator+(VTBignum&& lhs, const VTBignum& rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator+(const VTBignum& lhs, VTBignum&& rhs)
+{
+    rhs += lhs;
+    return std::move(rhs);
+}
+
+VTBignum operator+(VTBignum&& lhs, VTBignum&& rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator-(VTBignum&& lhs, const VTBignum& rhs)
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator-(const VTBignum& lhs, VTBignum&& rhs)
+{
+    // a - b == -(b - a)
+    rhs -= lhs;
+    return -std::move(rhs);
+}
+
+VTBignum operator-(VTBignum&& lhs, VTBignum&& rhs)
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator+(const VTBignum::Product& lhs, VTBignum&& rhs)
+{
+    rhs += lhs;
+    return std::move(rhs);
+}
+
+VTBignum operator+(VTBignum&& lhs, const VTBignum::Product& rhs)
+{
+    lhs += rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator-(const VTBignum::Product& lhs, VTBignum&& rhs)
+{
+    rhs -= lhs;
+    return -std::move(rhs);
+}
+
+VTBignum operator-(VTBignum&& lhs, const VTBignum::Product& rhs)
+{
+    lhs -= rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator*(VTBignum&& lhs, const VTBignum& rhs)
+{
+    lhs *= rhs;
+    return std::move(lhs);
+}
+
+VTBignum operator*(const VTBignum& lhs, VTBignum&& rhs)
+{
+    rhs *= lhs;
+    return std::move(rhs);
+}
+
+VTBignum operator*(VTBignum&& lhs, VTBignum&& rhs)
+{
+    lhs *= rhs;
+    return std::move(lhs);
+}
+#endif
+
+void VTBignum::divmod(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder)
+{
+    if (divisor.limbs() == 0)
+        throw std::runtime_error("Division by zero");
+
+    VTBignum q, r;
+    divmod_no_sign(dividend, divisor, q, r);
+
+    // signs are assigned after computing, because outputs may alias inputs
+    q._sign = (dividend._sign == 1) ^ (divisor._sign == 1);
+    r._sign = dividend._sign;
+    q.normilize();
+    r.normilize();
+
+    swap(quotient, q);
+    swap(remainder, r);
+}
+
+VTBignum& VTBignum::pow(unsigned long long power)
+{
+    VT_STAT_OPERATION(Stat_pow, limbs());
+    VTBignum aux = VTBignum::fromInt(1);
+    if (power == 0)
+    {
+        swap(*this, aux);
+        return *this;
+    }
+
+    while (power > 0)
+    {
+        if (power & 1)      //odd
+        {
+            aux *= *this;
+            if (power == 1)
+            {
+                swap(*this, aux);
+                return *this;
+            }
+        }
+        sqr();
+        power /= 2;
+    }
+
+    return *this;
+}
+
+VTBignum VTBignum::pow_modulo(const VTBignum& power, const VTBignum& mod) const
+{
+    VT_STAT_OPERATION(Stat_pow_modulo, limbs() + power.limbs() + mod.limbs());
+    if (mod.limbs() == 0)
+        throw std::runtime_error("Division by zero");
+    if (power._sign == 1)
+        throw std::runtime_error("Negative power");
+
+    VTBignum m(mod);
+    m._sign = 0;
+
+    // reduce base to [0, m)
+    VTBignum base = *this % m;
+    if (base._sign == 1)
+        base += m;
+
+    if (m == fromInt(1))
+        return VTBignum();
+    if (power.limbs() == 0)
+        return fromInt(1);
+
+    if (m._chunks[0] & 1)
+        return pow_montgomery(base, power, m);
+
+    /*
+        Even modulus m = 2^e * q has no Montgomery form. The odd part q goes
+        through Montgomery reduction, 2^e is reduced by masking the low bits,
+        and the two residues are joined by one CRT step:
+        x = x_q + q * ((x_2 - x_q) * q^-1 mod 2^e).
+    */
+    int e = 0;
+    while (m._chunks[e / LIMB_BITS] == 0)
+        e += LIMB_BITS;
+    e += count_trailing_zeros(m._chunks[e / LIMB_BITS]);
+    VTBignum q = m >> e;
+    VTBignum mask = (fromInt(1) << e) - fromInt(1);
+
+    // an even base to a power of at least e bits is 0 modulo 2^e
+    VTBignum low;
+    if ((base.limb(0) & 1) || (power.limbs() == 1 && power._chunks[0] < static_cast<limb_t>(e)))
+    {
+        low = fromInt(1);
+        VTBignum base_low = base & mask;
+        for (int i = power.bit_length() - 1; i >= 0; --i)
+        {
+            low.sqr();
+            low &= mask;
+            if (power.bit(i))
+            {
+                low *= base_low;
+                low &= mask;
+            }
+        }
+    }
+    if (q == fromInt(1))
+        return low;
+
+    VTBignum high = pow_montgomery(base % q, power, q);
+
+    // q^-1 mod 2^e by Newton iteration, each step doubles the correct low bits of an odd inverse
+    VTBignum inverse = fromInt(1);
+    for (int bits = 1; bits < e; bits *= 2)
+    {
+        inverse *= fromInt(2) - q * inverse;
+        inverse &= mask;
+    }
+    low -= high;
+    low *= inverse;
+    low &= mask;
+    return high + q * low;
+}
+
+/*
+    Sliding window exponentiation: exponent is scanned from the top bit,
+    runs of zeros cost one squaring per bit and every window of up to k bits
+    ending with 1 costs k squarings and one multiplication by a precomputed
+    odd power. All products are reduced with Montgomery reduction (REDC),
+    so the loop needs no division.
+*/
+VTBignum VTBignum::pow_montgomery(const VTBignum& base, const VTBignum& power, const VTBignum& m)
+{
+    VT_STAT_TIER(Stat_montgomery);
+    int n = m.limbs();
+    const limb_t* mod = &m._chunks[0];
+
+    // -m^-1 mod B by Newton iteration, m * m == 1 (mod 8) gives first 3 bits
+    limb_t m_inv = mod[0];
+    for (int i = 0; i < 5; ++i)
+        m_inv *= 2 - mod[0] * m_inv;
+    m_inv = 0 - m_inv;
+
+    // window size by exponent length, bigger windows pay off for longer exponents
+    int bits = power.bit_length();
+    int k = 1;
+    if (bits > 24) k = 3;
+    if (bits > 80) k = 4;
+    if (bits > 240) k = 5;
+    if (bits > 672) k = 6;
+    if (bits > 1792) k = 7;
+
+    // R^2 mod m converts to Montgomery form: REDC(x * R^2) == x * R
+    VTBignum r_squared = fromInt(1);
+    r_squared.shift_left(2 * n * LIMB_BITS);
+    r_squared %= m;
+
+    // all temporaries come from the scratch arena
+    int table_size = 1 << (k - 1);
+    ScratchFrame scratch;
+    limb_t* t = scratch.alloc(2 * n);
+    limb_t* operand = scratch.alloc(n);
+    limb_t* r2 = scratch.alloc(n);
+    limb_t* table = scratch.alloc(table_size * n);
+    limb_t* base_squared = scratch.alloc(n);
+    limb_t* acc = scratch.alloc(n);
+
+    std::fill(std::copy(base._chunks.begin(), base._chunks.end(), operand), operand + n, 0);
+    std::fill(std::copy(r_squared._chunks.begin(), r_squared._chunks.end(), r2), r2 + n, 0);
+
+    // table of odd powers base^1, base^3, ..., base^(2^k - 1) in Montgomery form
+    mul(t, operand, n, r2, n);
+    redc(table, t, mod, n, m_inv);
+
+    VTLimbs::sqr(t, table, n);
+    redc(base_squared, t, mod, n, m_inv);
+    for (int i = 1; i < table_size; ++i)
+    {
+        mul(t, &table[(i - 1) * n], n, base_squared, n);
+        redc(&table[i * n], t, mod, n, m_inv);
+    }
+
+    // top bit is always 1, so accumulator starts from the first window
+    bool started = false;
+
+    int i = bits - 1;
+    while (i >= 0)
+    {
+        if (!power.bit(i))
+        {
+            VTLimbs::sqr(t, acc, n);
+            redc(acc, t, mod, n, m_inv);
+            --i;
+            continue;
+        }
+
+        // longest window [i, low] of at most k bits that ends with 1
+        int low = std::max(i - k + 1, 0);
+        while (!power.bit(low))
+            ++low;
+
+        int window = 0;
+        for (int j = i; j >= low; --j)
+            window = (window << 1) | power.bit(j);
+
+        const limb_t* odd_power = &table[(window >> 1) * n];
+        if (!started)
+        {
+            std::copy(odd_power, odd_power + n, acc);
+            started = true;
+        }
+        else
+        {
+            for (int j = i; j >= low; --j)
+            {
+                VTLimbs::sqr(t, acc, n);
+                redc(acc, t, mod, n, m_inv);
+            }
+            mul(t, acc, n, odd_power, n);
+            redc(acc, t, mod, n, m_inv);
+        }
+
+        i = low - 1;
+    }
+
+    // out of Montgomery form: REDC(x * R) == x
+    std::copy(acc, acc + n, t);
+    std::fill(t + n, t + 2 * n, 0);
+    VTBignum result = create_empty();
+    result._chunks.resize(n);
+    redc(&result._chunks[0], t, mod, n, m_inv);
+    result.normilize();
+    return result;
+}
+
+VTBignum& VTBignum::operator++() // prefix
+{
+    return this->operator+=(fromInt(1));
+}
+
+VTBignum VTBignum::operator++(int unused) // postfix
+{
+    VTBignum saved = *this;
+    this->operator++();
+    return saved;
+}
+
+VTBignum& VTBignum::operator--() // prefix
+{
+    return this->operator-=(fromInt(1));
+}
+
+VTBignum VTBignum::operator--(int unused) // postfix
+{
+    VTBignum saved = *this;
+    this->operator--();
+    return saved;
+}
+
+bool operator==(const VTBignum& lhs, const VTBignum& rhs)
+{
+    return ( lhs._sign == rhs._sign && lhs._chunks == rhs._chunks );
+}
+
+bool operator!=(const VTBignum& lhs, const VTBignum& rhs)
+{
+    return !( lhs == rhs );
+}
+
+bool operator>(const VTBignum& lhs, const VTBignum& rhs)
+{
+    if ( lhs._sign != rhs._sign ) return ( lhs._sign == 0 );
+
+    int order = lhs.compare_no_sign(rhs);
+    return ( lhs._sign == 0 ? order > 0 : order < 0 );
+}
+
+bool operator<(const VTBignum& lhs, const VTBignum& rhs)
+{
+    return ( rhs > lhs );
+}
+
+bool operator>=(const VTBignum& lhs, const VTBignum& rhs)
+{
+    return !( lhs < rhs );
+}
+
+bool operator<=(const VTBignum& lhs, const VTBignum& rhs)
+{
+    return !( lhs > rhs );
+}
+
+VTBignum operator-(const VTBignum &bignum)
+{
+    VTBignum result(bignum);
+    // zero has no negative form
+    if (result.limbs() > 0)
+        result._sign = ! result._sign;
+    return result;
+}
+
+#if defined(VT_HAS_RVALUE_REFERENCES)
+VTBignum operator-(VTBignum&& bignum)
+{
+    if (bignum.limbs() > 0)
+        bignum._sign = ! bignum._sign;
+    return std::move(bignum);
+}
+#endif
+
+bool operator!(const VTBignum &bignum)
+{
+    return bignum.limbs() == 0;
+}
+
+VTBignum& VTBignum::operator<<=(int count)
+{
+    if (count < 0)
+        throw std::runtime_error("Negative shift");
+    shift_left(count);
+    return *this;
+}
+
+/*
+    Negative numbers are shifted as magnitudes, which rounds towards zero;
+    if any one bits were shifted out, the magnitude is increased by one,
+    so that the result is rounded down, like two's complement shift does.
+*/
+VTBignum& VTBignum::operator>>=(int count)
+{
+    if (count < 0)
+        throw std::runtime_error("Negative shift");
+
+    bool inexact = false;
+    if (_sign == 1)
+    {
+        int whole = std::min(count / LIMB_BITS, limbs());
+        int bits = count % LIMB_BITS;
+        for (int i = 0; i < whole && !inexact; ++i)
+            inexact = (_chunks[i] != 0);
+        if (whole < limbs() && bits != 0)
+            inexact = inexact || (_chunks[whole] << (LIMB_BITS - bits)) != 0;
+    }
+
+    char sign = _sign;
+    shift_right(count);
+    if (inexact)
+    {
+        limb_t one = 1;
+        add_no_sign(VTBignumView(&one, 1));
+        _sign = sign;
+    }
+    return *this;
+}
+
+VTBignum operator<<(const VTBignum& lhs, int count)
+{
+    // room for the shifted limbs, so that the copy is not reallocated
+    VTBignum result;
+    if (count > 0)
+        result._chunks.reserve(lhs.limbs() + count / LIMB_BITS + 1);
+    result = lhs;
+    result <<= count;
+    return result;
+}
+
+VTBignum operator>>(const VTBignum& lhs, int count)
+{
+    VTBignum result(lhs);
+    result >>= count;
+    return result;
+}
+
+VTBignum& VTBignum::operator&=(const VTBignum& rhs)
+{
+    bitwise(Bit_and, rhs);
+    return *this;
+}
+
+VTBignum& VTBignum::operator|=(const VTBignum& rhs)
+{
+    bitwise(Bit_or, rhs);
+    return *this;
+}
+
+VTBignum& VTBignum::operator^=(const VTBignum& rhs)
+{
+    bitwise(Bit_xor, rhs);
+    return *this;
+}
+
+VTBignum operator&(const VTBignum& lhs, const VTBignum& rhs)
+{
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result = lhs;
+    result &= rhs;
+    return result;
+}
+
+VTBignum operator|(const VTBignum& lhs, const VTBignum& rhs)
+{
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result = lhs;
+    result |= rhs;
+    return result;
+}
+
+VTBignum operator^(const VTBignum& lhs, const VTBignum& rhs)
+{
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result = lhs;
+    result ^= rhs;
+    return result;
+}
+
+VTBignum operator~(const VTBignum& bignum)
+{
+    // ~x == -x - 1 == -(x + 1)
+    VTBignum result;
+    result._chunks.reserve(bignum.limbs() + 1);
+    result = bignum;
+    limb_t one = 1;
+    if (result._sign == 0)
+    {
+        result.add_no_sign(VTBignumView(&one, 1));
+        result._sign = 1;
+    }
+    else
+    {
+        result.sub_no_sign(VTBignumView(&one, 1));
+        result._sign = 0;
+    }
+    return result;
+}
+
+int VTBignum::popcount() const
+{
+    if (_sign == 1)
+        return -1;
+
+    int count = 0;
+    for (int i = 0; i < limbs(); ++i)
+        count += VTLimbs::popcount(_chunks[i]);
+    return count;
+}
+
+/*
+    Two's complement of magnitude m is ~(m - 1): limbs below the lowest
+    non-zero one are 0, that one is negated and the limbs above are inverted.
+*/
+bool VTBignum::test_bit(int index) const
+{
+    if (index < 0)
+        throw std::runtime_error("Negative bit index");
+
+    int k = index / LIMB_BITS;
+    if (k >= limbs())
+        return _sign == 1;
+
+    limb_t limb = _chunks[k];
+    if (_sign == 1)
+    {
+        int lowest = 0;
+        while (_chunks[lowest] == 0)
+            ++lowest;
+        limb = ( k < lowest ? 0 : (k == lowest ? 0 - limb : ~limb) );
+    }
+    return ((limb >> (index % LIMB_BITS)) & 1) != 0;
+}
+
+/*
+    For negative numbers, setting a bit of ~(m - 1) clears the bit of m - 1
+    and the other way round, so the bit is changed in m - 1 with the value
+    inverted.
+*/
+void VTBignum::set_bit(int index, bool value)
+{
+    if (index < 0)
+        throw std::runtime_error("Negative bit index");
+
+    char sign = _sign;
+    limb_t one = 1;
+    if (sign == 1)
+    {
+        sub_no_sign(VTBignumView(&one, 1));
+        value = !value;
+    }
 
-    int i = 0;
-    char sign = 0;
-    if (char_array[i] == '-')
+    int k = index / LIMB_BITS;
+    limb_t mask = one << (index % LIMB_BITS);
+    if (k < limbs())
     {
-        sign = 1;
-        ++i;
+        if (value)
+            _chunks[k] |= mask;
+        else
+            _chunks[k] &= ~mask;
     }
-    else if (char_array[i] == '+')
+    else if (value)
     {
-        sign = 0;
-        ++i;
+        _chunks.resize(k + 1, 0);
+        _chunks[k] = mask;
     }
 
-    for ( /* none */; char_array[i] != '\0' && i < size; ++i)
+    if (sign == 1)
     {
-        if ( char_array[i] < '0' || char_array[i] > (base == Base_10 ? '9' : 'f') )
-            throw std::runtime_error("Wrong character in number");
-
-        bignum = (bignum * fromInt(base)) + fromInt(char_array[i] - '0');
+        normilize();
+        add_no_sign(VTBignumView(&one, 1));
+        _sign = 1;
+    }
+    else
+    {
+        normilize();
     }
+}
 
-    bignum._sign = sign;
+// PRIVATE FUNCTIONS
+
+VTBignum VTBignum::create_empty()
+{
+    VTBignum bignum;
+    bignum._chunks.clear();
     return bignum;
 }
 
-char VTBignum::toByteArray(unsigned char* bytes) const
+void VTBignum::multiply(const VTBignumView& a, const VTBignumView& b, VTBignum& product)
 {
-    for (int i = 0; i < size(); ++i)
+    VT_STAT_OPERATION(a.data() == b.data() ? Stat_sqr : Stat_mul, a.limbs() + b.limbs());
+
+    if (a.limbs() == 0 || b.limbs() == 0)
     {
-        bytes[i] = _chunks[i];
+        product._chunks.clear();
+        product._sign = 0;
+        return;
     }
-    return _sign;
-}
 
-long long VTBignum::toLongLong() const
-{
-    if (size() > sizeof(long long))
-        throw std::runtime_error("Number is too big for long long");
-    else if (size() == sizeof(long long) && _chunks[size()-1] & 0x80) // one bit is needed for sign in signed long long
-        throw std::runtime_error("Number is too big for long long");
+    /*
+        + (0) ^ + (0)   ->   + (0)
+        + (0) ^ - (1)   ->   - (1)
+        - (1) ^ + (0)   ->   - (1)
+        - (1) ^ - (1)   ->   + (0)
+    */
+    char sign = (a.sign() == 1) ^ (b.sign() == 1);
+    int n = a.limbs() + b.limbs();
+    bool aliased = (a.data() == product._chunks.begin() || b.data() == product._chunks.begin());
 
-    long long result = 0;
-    std::vector<unsigned char>::const_reverse_iterator pdigit;
-    for (pdigit = _chunks.rbegin(); pdigit != _chunks.rend(); ++pdigit)
+    // product of small numbers goes through the stack, so that it stays inline if it fits;
+    // product overwriting an operand is built aside
+    limb_t local[2 * VTBIGNUM_INLINE_LIMBS];
+    VTBignum accumulator;
+    limb_t* r = local;
+    if (n > 2 * VTBIGNUM_INLINE_LIMBS)
     {
-        result *= 256;
-        result += *pdigit;
+        VTBignum& target = (aliased ? accumulator : product);
+        target._chunks.resize(n);
+        r = &target._chunks[0];
     }
 
-    if (_sign == 1)
-        result *= -1;
+    // longer operand goes first, mul() picks the algorithm and squares a * a
+    if (a.limbs() >= b.limbs())
+        mul(r, a.data(), a.limbs(), b.data(), b.limbs());
+    else
+        mul(r, b.data(), b.limbs(), a.data(), a.limbs());
 
-    return result;
+    if (r == local)
+        product._chunks.assign(local, local + normalized_size(local, n));
+    else if (aliased)
+        product._chunks.swap(accumulator._chunks);
+
+    product._sign = sign;
+    product.normilize();
 }
 
-std::string VTBignum::toString(int base) const
+/*
+    Multiply-accumulate: rows b[i] * a are added to (or subtracted from)
+    the limbs of this in place, like in schoolbook multiplication, so that
+    the product is never stored. Subtraction that goes below zero wraps
+    around once, and is turned back into magnitude and sign at the end.
+    Long operands are multiplied by the faster algorithms first.
+*/
+void VTBignum::add_product(const VTBignum& a, const VTBignum& b, bool subtract)
 {
-    assert(base > 1 && base <= 256);
+    VT_STAT_OPERATION(Stat_fma, limbs() + a.limbs() + b.limbs());
 
-    if (base == 256 || base == 16)
-        return print(*this, base);
-
-    VTBignum dest = create_empty();
+    if (a.limbs() == 0 || b.limbs() == 0)
+        return;
 
-    // size needed to hold this number in given base
-    while ( dest.size() < ceil( size() * log(static_cast<double>(256))/log(static_cast<double>(base)) ) )
-        dest._chunks.push_back(0);
+    const VTBignum& x = (a.limbs() >= b.limbs() ? a : b);
+    const VTBignum& y = (a.limbs() >= b.limbs() ? b : a);
+    char product_sign = ((a._sign == 1) ^ (b._sign == 1) ^ subtract);
 
-    std::vector<unsigned char>::const_reverse_iterator base256_digit;
-    for (base256_digit = _chunks.rbegin(); base256_digit != _chunks.rend(); ++base256_digit)
+    if (this == &a || this == &b || y.limbs() >= thresholds.mul_karatsuba)
     {
-        int overflow = *base256_digit;
-        int i = 0;
-
-        for (i = 0; i < dest.size(); ++i)
+        VTBignum product;
+        multiply(x, y, product);
+        if (limbs() == 0 || _sign == product_sign)
         {
-            int acc = (dest._chunks[i] * 256) + overflow;
-            dest._chunks[i] = acc % base;
-            overflow = acc / base;
+            _sign = product_sign;
+            add_no_sign(product);
         }
-
-        while (overflow > 0)
+        else
         {
-            dest._chunks[i] = overflow % base;
-            overflow = overflow / base;
-            ++i;
+            sub_no_sign(product);
         }
+        return;
     }
 
-    dest.normilize();
+    bool add = (limbs() == 0 || _sign == product_sign);
+    if (limbs() == 0)
+        _sign = product_sign;
 
-    return print(dest, base);
-}
+    int xn = x.limbs();
+    int yn = y.limbs();
+    int n = std::max(limbs(), xn + yn);
+    _chunks.resize(n, 0);
+    limb_t* r = &_chunks[0];
 
-VTBignum& VTBignum::operator+=(const VTBignum &rhs)
-{
-    // use base's complement addition for adding negative to positive
-    if (_sign != rhs._sign)
+    // carries (or borrows) out of the top limb, their total is 0 or 1;
+    // n >= xn + yn, so every row has a limb above it to take its high limb
+    limb_t top = 0;
+    for (int i = 0; i < yn; ++i)
     {
-        int this_is_bigger = compare_no_sign(rhs);
-        int len = ( this_is_bigger > 0 ? size() : rhs.size() );
-        
-        if (this_is_bigger == 0) return this->operator=( fromInt(0) );
-        
-        if (_sign == 1)      // this < 0
-        {
-            if (this_is_bigger > 0)     
-                _sign = 1;      // result < 0  ( -6 + 3 )
-            else
-                _sign = 0;       // result > 0  ( -3 + 6 )
-
-            this->operator=( complement( *this, len, 256 ) );
-            add_no_sign(rhs);
-        }
-        else /* _sign == 0 */     // this >= 0
+        if (add)
         {
-            if (this_is_bigger > 0)     
-                _sign = 0;      // result < 0  ( 6 + -3 )
-            else
-                _sign = 1;       // result > 0  ( 3 + -6 )
-
-            add_no_sign( complement( rhs, len, 256 ) );
+            limb_t carry = addmul_1(r + i, &x._chunks[0], xn, y._chunks[i]);
+            top += add_1(r + i + xn, r + i + xn, n - i - xn, carry);
         }
-
-        // add 1 as per algorithm specification
-        add_no_sign(fromInt(1));
-
-        // if overflow was considered, drop it
-        if (size() > len)
-            _chunks.pop_back();
-
-        // convert back to regular form
-        if (_sign == 1)
+        else
         {
-            this->operator=(complement(*this, len, 256));
-            add_no_sign(fromInt(1));
+            limb_t borrow = submul_1(r + i, &x._chunks[0], xn, y._chunks[i]);
+            top += sub_1(r + i + xn, r + i + xn, n - i - xn, borrow);
         }
+    }
 
-        normilize();
-
+    if (add && top != 0)
+    {
+        _chunks.push_back(top);
     }
-    else
+    else if (!add && top != 0)
     {
-        add_no_sign(rhs);
+        // got B^n - |result|, negate it
+        for (int i = 0; i < n; ++i)
+            r[i] = ~r[i];
+        add_1(r, r, n, 1);
+        invert();
     }
 
-    return *this;
+    normilize();
 }
 
+void VTBignum::add_no_sign(const VTBignumView& rhs)
+{
+    // increase this if it is shorter
+    if (limbs() < rhs.limbs())
+        _chunks.resize(rhs.limbs(), 0);
 
+    limb_t carry = 0;
 
-const VTBignum VTBignum::operator+(const VTBignum &other) const
-{
-    return VTBignum(*this) += other;
-}
+    // add limbs
+    for (int i = 0; i < rhs.limbs(); ++i)
+        _chunks[i] = add_carry(_chunks[i], rhs.data()[i], carry);
 
-VTBignum& VTBignum::operator-=(const VTBignum &rhs)
-{
-    return this->operator+=(-rhs);
-}
+    // propagate carry
+    for (int i = rhs.limbs(); i < limbs() && carry != 0; ++i)
+        _chunks[i] = add_carry(_chunks[i], 0, carry);
 
-const VTBignum VTBignum::operator-(const VTBignum &other) const
-{
-    return VTBignum(*this) -= other;
+    if (carry > 0)
+        _chunks.push_back(carry);
 }
 
-VTBignum& VTBignum::operator*=(const VTBignum &rhs)
+void VTBignum::sub_no_sign(const VTBignumView& rhs)
 {
-    if (this->operator==(fromInt(0)) || rhs == fromInt(0)) return this->operator=(fromInt(0));
+    if (rhs.limbs() == 0)
+        return;
 
-    VTBignum accumulator;
-    /*
-        + (0) ^ + (0)   ->   + (0)
-        + (0) ^ - (1)   ->   - (1)
-        - (1) ^ + (0)   ->   - (1)
-        - (1) ^ - (1)   ->   + (0)
-    */
-    accumulator._sign = (_sign == 1) ^ (rhs._sign == 1);
+    int this_is_bigger = compare_no_sign(rhs);
 
-    for (int i = 0; i < rhs.size(); ++i)
-        mult_by_single_digit(accumulator, rhs._chunks[i], i);
+    if (this_is_bigger == 0)
+    {
+        _chunks.clear();
+    }
+    else if (this_is_bigger > 0)
+    {
+        limb_t borrow = sub(&_chunks[0], &_chunks[0], limbs(), rhs.data(), rhs.limbs());
+        assert(borrow == 0);
+    }
+    else
+    {
+        // subtract in the other direction and change the sign ( 3 - 6 == -(6 - 3) )
+        int len = limbs();
+        _chunks.resize(rhs.limbs());
+        limb_t borrow = sub(&_chunks[0], rhs.data(), rhs.limbs(), &_chunks[0], len);
+        assert(borrow == 0);
+        invert();
+    }
 
-    this->operator=(accumulator);
-    return *this;
+    normilize();
 }
 
-const VTBignum VTBignum::operator*(const VTBignum &other) const
+/*
+    Write number < chunk^(2^level) as exactly tree.width(level) digit values.
+    Long numbers are split by the middle power of the tree, so that the
+    conversion costs a few divisions at every level instead of quadratic
+    time; short ones are peeled off a limb sized chunk at a time.
+*/
+void VTBignum::write_digits(const VTBignum& number, int level, const PowerTree& tree, DigitSink& out)
 {
-    return VTBignum(*this) *= other;
-}
+    if (level == 0 || number.limbs() < thresholds.str_dc)
+    {
+        ScratchFrame scratch;
+        int n = number.limbs();
+        limb_t* rest = scratch.alloc(n);
+        std::copy(number._chunks.begin(), number._chunks.end(), rest);
 
-VTBignum& VTBignum::pow(unsigned long long power)
-{
-    VTBignum aux = VTBignum::fromInt(1);
+        // chunk >= 2^56 in every base, so n limbs make at most 8n / 7 + 1 chunks
+        int room = (8 * n / 7 + 1) * tree.chunk_digits;
+        char* digits = reinterpret_cast<char*>(scratch.alloc(room / LIMB_BYTES + 1));
+        int pos = room;
 
-    while (power > 0)
-    {
-        if (power & 1)      //odd
+        while (n > 0)
         {
-            aux *= *this;
-            if (power == 1)
+            limb_t chunk = divrem_1(rest, rest, n, tree.chunk);
+            n = normalized_size(rest, n);
+
+            for (int i = 0; i < tree.chunk_digits; ++i)
             {
-                *this = aux;
-                return *this;
+                digits[--pos] = static_cast<char>(chunk % tree.base);
+                chunk /= tree.base;
             }
         }
-        *this *= *this;
-        power /= 2;
+
+        out.zeros(tree.width(level) - (room - pos));
+        out.put(digits + pos, room - pos);
+        return;
     }
 
-    return *this;
+    VTBignum high, low;
+    if (tree.inverses[level - 1].limbs() > 0)
+        divmod_reciprocal(number, tree.normalized[level - 1], tree.inverses[level - 1], tree.shifts[level - 1], high, low);
+    else
+        divmod_no_sign(number, tree.powers[level - 1], high, low);
+    write_digits(high, level - 1, tree, out);
+    write_digits(low, level - 1, tree, out);
 }
 
-VTBignum& VTBignum::operator++() // prefix
+/*
+    Read count <= tree.width(level) digits, the most significant first.
+    Long inputs are split at the width of the level below and the halves
+    are combined with a single multiplication by its power; short ones
+    are accumulated a limb sized chunk of digits at a time.
+*/
+VTBignum VTBignum::read_digits(const char* digits, int count, int level, const PowerTree& tree)
 {
-    return this->operator+=(fromInt(1));
-}
+    if (level > 0 && count <= tree.width(level - 1))
+        return read_digits(digits, count, level - 1, tree);
 
-VTBignum VTBignum::operator++(int unused) // postfix
-{
-    VTBignum saved = *this;
-    this->operator++();
-    return saved;
-}
+    if (level == 0 || count / tree.chunk_digits < thresholds.str_dc)
+    {
+        VTBignum bignum = create_empty();
+        bignum._chunks.reserve(count / tree.chunk_digits + 2);
 
-VTBignum& VTBignum::operator--() // prefix
-{
-    return this->operator-=(fromInt(1));
-}
+        // the first chunk takes the leftover digits, so that the rest are full
+        int k = 0;
+        int first = count % tree.chunk_digits;
+        if (first == 0)
+            first = tree.chunk_digits;
 
-VTBignum VTBignum::operator--(int unused) // postfix
-{
-    VTBignum saved = *this;
-    this->operator--();
-    return saved;
-}
+        for (int end = first; end <= count; end += tree.chunk_digits)
+        {
+            limb_t chunk = 0;
+            for (/* none */; k < end; ++k)
+                chunk = chunk * tree.base + digit_value(digits[k]);
+
+            int n = bignum.limbs();
+            limb_t carry = (n > 0 ? mul_1(&bignum._chunks[0], &bignum._chunks[0], n, tree.chunk) : 0);
+            if (n > 0)
+                carry += add_1(&bignum._chunks[0], &bignum._chunks[0], n, chunk);
+            else
+                carry = chunk;
 
-bool VTBignum::operator==(const VTBignum& other) const
-{
-    return ( this->_sign == other._sign && this->_chunks == other._chunks );
-}
+            if (carry != 0)
+                bignum._chunks.push_back(carry);
+        }
+        return bignum;
+    }
 
-bool VTBignum::operator!=(const VTBignum& other) const
-{
-    return !( this->operator==(other) );
+    int low_count = tree.width(level - 1);
+    VTBignum bignum = read_digits(digits, count - low_count, level - 1, tree);
+    bignum *= tree.powers[level - 1];
+    bignum.add_no_sign(read_digits(digits + count - low_count, low_count, level - 1, tree));
+    return bignum;
 }
 
-bool VTBignum::operator>(const VTBignum& other) const
+namespace
 {
-    if ( _sign != other._sign ) return ( _sign == 0 );
+    // limbs of a number in two's complement, from the least significant one;
+    // negative magnitude m is ~m + 1, beyond n limbs come copies of mask
+    struct TwosComplement
+    {
+        TwosComplement(const limb_t* data, int size, char sign)
+            : limbs(data), n(size), mask(sign == 1 ? LIMB_MAX : 0), carry(sign == 1 ? 1 : 0)
+        {}
+
+        inline limb_t next(int i)
+        {
+            limb_t x = (limbs[i] ^ mask) + carry;
+            carry &= (x == 0);
+            return x;
+        }
+
+        const limb_t* limbs;
+        int n;
+        limb_t mask;
+        limb_t carry;
+    };
 
-    bool bigger = (compare_no_sign(other) > 0);
-    return ( _sign == 0 ? bigger : !bigger );
+    struct And { static inline limb_t apply(limb_t x, limb_t y) { return x & y; } };
+    struct Or { static inline limb_t apply(limb_t x, limb_t y) { return x | y; } };
+    struct Xor { static inline limb_t apply(limb_t x, limb_t y) { return x ^ y; } };
+
+    // r gets max(a.n, b.n) limbs of a op b, return the mask of the limbs above them;
+    // r may be a or b
+    template <class Op>
+    limb_t bitwise_limbs(limb_t* r, TwosComplement a, TwosComplement b)
+    {
+        if (a.n < b.n)
+            std::swap(a, b);
+
+        // magnitudes are normalised, so the carry never goes past the top limb
+        for (int i = 0; i < b.n; ++i)
+            r[i] = Op::apply(a.next(i), b.next(i));
+        for (int i = b.n; i < a.n; ++i)
+            r[i] = Op::apply(a.next(i), b.mask);
+        return Op::apply(a.mask, b.mask);
+    }
 }
 
-bool VTBignum::operator<(const VTBignum& other) const
+/*
+    Both operands are converted to two's complement a limb at a time while
+    the result is written, and the result is converted back in place if it
+    is negative, so that the operation is two passes over the limbs at most.
+    One limb above the longer operand holds the magnitude of -2^(64 * n).
+*/
+void VTBignum::bitwise(BitOperation operation, const VTBignumView& bignum)
 {
-    if ( _sign != other._sign ) return ( _sign == 1 );
+    if (bignum.data() == _chunks.begin())
+    {
+        // x & x == x | x == x, x ^ x == 0
+        if (operation == Bit_xor)
+        {
+            _chunks.clear();
+            _sign = 0;
+        }
+        return;
+    }
 
-    bool smaller = (compare_no_sign(other) < 0);
-    return ( _sign == 0 ? smaller : !smaller );
+    int an = limbs();
+    int n = std::max(an, bignum.limbs());
+    _chunks.resize(n + 1);
+    limb_t* r = &_chunks[0];
+
+    TwosComplement a(r, an, _sign);
+    TwosComplement b(bignum.data(), bignum.limbs(), bignum.sign());
+    limb_t mask;
+    if (operation == Bit_and)
+        mask = bitwise_limbs<And>(r, a, b);
+    else if (operation == Bit_or)
+        mask = bitwise_limbs<Or>(r, a, b);
+    else
+        mask = bitwise_limbs<Xor>(r, a, b);
+    r[n] = mask;
+
+    _sign = ( mask != 0 ? 1 : 0 );
+    if (_sign == 1)
+    {
+        limb_t carry = 1;
+        for (int i = 0; i <= n; ++i)
+        {
+            r[i] = ~r[i] + carry;
+            carry &= (r[i] == 0);
+        }
+    }
+    normilize();
 }
 
-bool VTBignum::operator>=(const VTBignum& other) const
+int VTBignum::bit_length() const
 {
-    return !( this->operator<(other) );
+    if (limbs() == 0)
+        return 0;
+    return limbs() * LIMB_BITS - count_leading_zeros(_chunks.back());
 }
 
-bool VTBignum::operator<=(const VTBignum& other) const
+void VTBignum::shift_left(int count)
 {
-    return !( this->operator>(other) );
+    assert(count >= 0);
+    if (limbs() == 0 || count == 0)
+        return;
+
+    int whole = count / LIMB_BITS;
+    int bits = count % LIMB_BITS;
+    int len = limbs();
+
+    _chunks.resize(len + whole + 1, 0);
+    if (bits != 0)
+        _chunks[len + whole] = lshift(&_chunks[whole], &_chunks[0], len, bits);
+    else
+        memmove(&_chunks[whole], &_chunks[0], len * sizeof(limb_t));
+    std::fill(_chunks.begin(), _chunks.begin() + whole, 0);
+
+    normilize();
 }
 
-VTBignum operator-(const VTBignum &bignum)
+void VTBignum::shift_right(int count)
 {
-    VTBignum result(bignum);
-    result._sign = ! result._sign;
-    return result;
+    assert(count >= 0);
+    int whole = count / LIMB_BITS;
+    int bits = count % LIMB_BITS;
+
+    if (whole >= limbs())
+    {
+        _chunks.clear();
+        normilize();
+        return;
+    }
+
+    int len = limbs() - whole;
+    if (bits != 0)
+        rshift(&_chunks[0], &_chunks[whole], len, bits);
+    else
+        memmove(&_chunks[0], &_chunks[whole], len * sizeof(limb_t));
+    _chunks.resize(len);
+
+    normilize();
 }
 
-bool operator!(const VTBignum &bignum)
+void VTBignum::divmod_no_sign(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder)
 {
-    return bignum == VTBignum::fromLongLong(0);
-}
+    VT_STAT_OPERATION(Stat_div, dividend.limbs() + divisor.limbs());
 
-// PRIVATE FUNCTIONS
+    int an = dividend.limbs();
+    int dn = divisor.limbs();
 
-VTBignum VTBignum::create_empty()
-{
-    VTBignum bignum;
-    bignum._chunks.clear();
-    return bignum;
+    if (dividend.compare_no_sign(divisor) < 0)
+    {
+        quotient = VTBignum();
+        remainder = dividend;
+        remainder._sign = 0;
+        return;
+    }
+
+    int qn = an - dn + 1;
+    if (dn >= thresholds.div_newton && qn >= thresholds.div_newton)
+        divmod_newton(dividend, divisor, quotient, remainder);
+    else
+        divmod_knuth(dividend, divisor, quotient, remainder);
 }
 
-void VTBignum::add_no_sign(const VTBignum& rhs, int base)
+void VTBignum::divmod_knuth(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder)
 {
-    assert(base > 1 && base <=256);
+    int an = dividend.limbs();
+    int dn = divisor.limbs();
+    int qn = an - dn + 1;
+    assert(qn >= 1);
 
-    // increase this if it is shorter
-    while (size() < rhs.size())
-        _chunks.push_back(0);
-
-    int overflow = 0;
+    quotient._sign = 0;
+    quotient._chunks.resize(qn);
+    remainder._sign = 0;
 
-    // add digits
-    for (int i = 0; i < rhs.size(); ++i)
+    if (dn == 1)
     {
-        int sum = _chunks[i] + rhs._chunks[i] + overflow;
-        _chunks[i] = sum % base;
-        overflow = sum / base;
+        // single limb divisor, one hardware division per limb
+        remainder._chunks.assign(1, divrem_1(&quotient._chunks[0], &dividend._chunks[0], an, divisor._chunks[0]));
     }
-
-    // propagate overflow
-    for (int i = rhs.size(); i < size(); ++i)
+    else
     {
-        if (overflow == 0)
-            break;
-
-        int sum = _chunks[i] + overflow;
-        _chunks[i] = sum % base;
-        overflow = sum / base;
+        remainder._chunks.resize(dn);
+        divrem(&quotient._chunks[0], &remainder._chunks[0], &dividend._chunks[0], an, &divisor._chunks[0], dn);
     }
 
-    if (overflow > 0)
-        _chunks.push_back(overflow);
+    quotient.normilize();
+    remainder.normilize();
 }
 
-int VTBignum::compare_no_sign(const VTBignum& other) const
+/*
+    Division by multiplication with a reciprocal, which is computed by Newton
+    iteration, so that division costs a constant number of multiplications.
+*/
+void VTBignum::divmod_newton(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder)
 {
-    // this is longer then other
-    if ( size() != other.size() ) return size() - other.size();
+    VT_STAT_TIER(Stat_div_newton);
+    VTBignum a(dividend), d(divisor);
+    a._sign = 0;
+    d._sign = 0;
 
-    // start comparing from most significant digits
-    assert(size() == other.size());
+    int qn = a.limbs() - d.limbs() + 1;
 
-    for (int i = size() - 1; i >= 0; --i)
+    // a divisor much longer than the quotient only matters with its top limbs:
+    // quotient of the truncated numbers is off by at most one
+    if (d.limbs() > qn + 2)
     {
-        int diff = _chunks[i] - other._chunks[i];
-        if (diff != 0)
-            return diff;
+        int cut = (d.limbs() - qn - 2) * LIMB_BITS;
+        VTBignum a_top(a), d_top(d), unused;
+        a_top.shift_right(cut);
+        d_top.shift_right(cut);
+        divmod_newton(a_top, d_top, quotient, unused);
+
+        remainder = a - quotient * d;
+        while (remainder._sign == 1)
+        {
+            --quotient;
+            remainder += d;
+        }
+        while (remainder.compare_no_sign(d) >= 0)
+        {
+            ++quotient;
+            remainder -= d;
+        }
+        return;
     }
 
-    // they are equal
-    return 0;
+    // normalise, so that the top bit of divisor is set
+    int shift = count_leading_zeros(d._chunks.back());
+    d.shift_left(shift);
+
+    divmod_reciprocal(a, d, reciprocal(d), shift, quotient, remainder);
 }
 
-void VTBignum::mult_by_single_digit(VTBignum& accumulator, unsigned char digit, int position, int base)
+void VTBignum::divmod_reciprocal(const VTBignum& dividend, const VTBignum& divisor, const VTBignum& inverse, int shift,
+                                 VTBignum& quotient, VTBignum& remainder)
 {
-    assert(base > 1 && base <=256);
-    assert(position >= 0);
+    VTBignum a(dividend);
+    a._sign = 0;
+    a.shift_left(shift);
+
+    const VTBignum& d = divisor;
+    int n = d.limbs();
+
+    // long division with blocks of n limbs as digits, every block of the
+    // quotient is estimated from the top n + 1 limbs of (remainder:block)
+    // as top * inverse / B^(n + 1), which is off by at most two
+    int blocks = (a.limbs() + n - 1) / n;
+    quotient._sign = 0;
+    quotient._chunks.assign(blocks * n, 0);
+    remainder = VTBignum();
+
+    for (int i = blocks - 1; i >= 0; --i)
+    {
+        int len = std::min(n, a.limbs() - i * n);
+        VTBignum block = create_empty();
+        block._chunks.assign(a._chunks.begin() + i * n, a._chunks.begin() + i * n + len);
+        block.normilize();
+
+        remainder.shift_left(n * LIMB_BITS);
+        remainder += block;
+
+        VTBignum q_block(remainder);
+        q_block.shift_right((n - 1) * LIMB_BITS);
+        q_block *= inverse;
+        q_block.shift_right((n + 1) * LIMB_BITS);
+        remainder -= q_block * d;
+        while (remainder.compare_no_sign(d) >= 0)
+        {
+            ++q_block;
+            remainder -= d;
+        }
 
-    if (digit == 0)
-        return;
+        std::copy(q_block._chunks.begin(), q_block._chunks.end(), quotient._chunks.begin() + i * n);
+    }
 
-    int overflow = 0;
+    quotient.normilize();
+    remainder.shift_right(shift);
+}
 
-    for (int i = 0; i < size(); ++i)
-    {
-        //increase accumulator to needed size
-        while (accumulator.size() < position + i + 1)
-            accumulator._chunks.push_back(0);
+VTBignum VTBignum::reciprocal(const VTBignum& divisor)
+{
+    int n = divisor.limbs();
 
-        int acc = (_chunks[i] * digit) + overflow + accumulator._chunks[position+i];
-        accumulator._chunks[position+i] = acc % base;
-        overflow = acc / base;
-    }
+    VTBignum power = fromInt(1);
+    power.shift_left(2 * n * LIMB_BITS);
 
-    if (overflow > 0)
+    VTBignum inverse, rest;
+    if (n < 4 || n < thresholds.div_newton)
     {
-        while (accumulator.size() < position + size() + 1)
-            accumulator._chunks.push_back(0);
-
-        accumulator._chunks[position + size()] = overflow;
+        divmod_knuth(power, divisor, inverse, rest);
+        return inverse;
     }
-}
 
-VTBignum VTBignum::complement(const VTBignum& bignum, int size, int base)
-{
-    assert(size >= bignum.size());
-    assert(base > 1 && base <= 256);
+    // reciprocal of the top half is precise to about half of the limbs
+    int h = (n + 1) / 2 + 1;
+    VTBignum top(divisor);
+    top.shift_right((n - h) * LIMB_BITS);
+    VTBignum top_inverse = reciprocal(top);
 
-    VTBignum new_bignum = create_empty();
+    inverse = top_inverse;
+    inverse.shift_left((n - h) * LIMB_BITS);
 
-    // preserve original sign
-    new_bignum._sign = bignum._sign;
+    /*
+        Newton step for f(x) = 1/x - d: x += x * (B^2n - d * x) / B^2n.
+        Error term is about B^(2n - h) and only its top limbs matter,
+        as is the top part of x (its low limbs are zero anyway).
+    */
+    VTBignum error = power - divisor * inverse;
+    int cut = n - 2;
+    error.shift_right(cut * LIMB_BITS);
+    VTBignum correction = top_inverse * error;
+    correction.shift_right((2 * n - cut - (n - h)) * LIMB_BITS);
+    inverse += correction;
+
+    // step result is off by a few units, make it exact
+    rest = power - divisor * inverse;
+    while (rest._sign == 1)
+    {
+        --inverse;
+        rest += divisor;
+    }
+    while (rest.compare_no_sign(divisor) >= 0)
+    {
+        ++inverse;
+        rest -= divisor;
+    }
 
-    std::vector<unsigned char>::const_iterator pdigit;
-    for (pdigit = bignum._chunks.begin(); pdigit != bignum._chunks.end(); ++pdigit)
-        new_bignum._chunks.push_back( base - 1 - *pdigit );
+    return inverse;
+}
 
-    // fill missing size with max digit in current base
-    // (just like when shifting right negative binary two's complement numbers)
-    while ( new_bignum.size() < size )
-        new_bignum._chunks.push_back( base - 1 );
+int VTBignum::compare_no_sign(const VTBignumView& other) const
+{
+    // this is longer then other
+    if ( limbs() != other.limbs() ) return ( limbs() > other.limbs() ? 1 : -1 );
 
-    return new_bignum;
+    // start comparing from most significant limbs
+    return cmp(&_chunks[0], other.data(), limbs());
 }
 
 void VTBignum::normilize()
 {
-    if (size() == 0) return;
-    while (_chunks[size()-1] == 0)
+    while (!_chunks.empty() && _chunks.back() == 0)
         _chunks.pop_back();
+
+    // zero is always positive
+    if (_chunks.empty())
+        _sign = 0;
 }
 
-std::string VTBignum::print(const VTBignum& source, int base)
+std::string VTBignum::print(const std::vector<unsigned char>& digits, int base, char sign)
 {
     assert(base > 1 && base <= 256);
 
-    if (source.size() == 0)
+    if (digits.size() == 0)
         return std::string("0");
 
     int width;
@@ -515,13 +2357,15 @@ std::string VTBignum::print(const VTBignum& source, int base)
         width = 3;
 
     std::stringstream ss;
+    if (sign == 1)
+        ss << '-';
+
     std::vector<unsigned char>::const_reverse_iterator digit;
-    for (digit = source._chunks.rbegin(); digit != source._chunks.rend(); ++digit)
+    for (digit = digits.rbegin(); digit != digits.rend(); ++digit)
     {
         ss << ( width == 1 || base == 256 ? std::hex : std::dec ) << std::setw(width);
         if (base == 16)
         {
-            unsigned char a = *digit;
             ss << static_cast<int>((*digit & 0xf0) >> 4) << static_cast<int>(*digit & 0x0f);
         }
         else
@@ -539,5 +2383,43 @@ std::string VTBignum::print(const VTBignum& source, int base)
 void swap(VTBignum& first, VTBignum& second)
 {
     std::swap(first._sign, second._sign); 
-    std::swap(first._chunks, second._chunks);
-}
\ No newline at end of file
+    first._chunks.swap(second._chunks);
+}
+
+// VTBignumView
+
+int VTBignumView::compare(const VTBignumView& lhs, const VTBignumView& rhs)
+{
+    if (lhs._sign != rhs._sign)
+        return ( lhs._sign == 0 ? 1 : -1 );
+
+    int order = ( lhs._limbs != rhs._limbs ? (lhs._limbs > rhs._limbs ? 1 : -1) : cmp(lhs._data, rhs._data, lhs._limbs) );
+    return ( lhs._sign == 0 ? order : -order );
+}
+
+VTBignum operator+(const VTBignumView& lhs, const VTBignumView& rhs)
+{
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result._chunks.assign(lhs.data(), lhs.data() + lhs.limbs());
+    result._sign = lhs.sign();
+    result += rhs;
+    return result;
+}
+
+VTBignum operator-(const VTBignumView& lhs, const VTBignumView& rhs)
+{
+    VTBignum result;
+    result._chunks.reserve(std::max(lhs.limbs(), rhs.limbs()) + 1);
+    result._chunks.assign(lhs.data(), lhs.data() + lhs.limbs());
+    result._sign = lhs.sign();
+    result -= rhs;
+    return result;
+}
+
+VTBignum operator*(const VTBignumView& lhs, const VTBignumView& rhs)
+{
+    VTBignum result;
+    VTBignum::multiply(lhs, rhs, result);
+    return result;
+}
@@ -28,45 +28,170 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #pragma once
 
+#include <stdio.h>
 #include <vector>
 #include <string>
+#include <iosfwd>
 
-#define MAX_STRING 8192
+#include "VTLimbs.h"
+#include "VTLimbVector.h"
+#include "VTStats.h"
+
+// numbers up to this many limbs are stored without heap allocation
+#ifndef VTBIGNUM_INLINE_LIMBS
+#define VTBIGNUM_INLINE_LIMBS 2
+#endif
+#if VTBIGNUM_INLINE_LIMBS < 1
+#error VTBIGNUM_INLINE_LIMBS must be at least 1
+#endif
+
+// allocator of limbs for longer numbers
+#ifndef VTBIGNUM_ALLOCATOR
+#define VTBIGNUM_ALLOCATOR std::allocator<VTLimbs::limb_t>
+#endif
+
+class VTBignum;
+
+/*
+    Read-only number over limbs owned by someone else, e.g. a network frame
+    or a memory mapped file: least significant limb first, in native byte
+    order, which is the little-endian byte layout on little-endian machines.
+    Nothing is copied, so the memory must outlive the view and stay unchanged
+    while the view is used. VTBignum converts to a view of its own limbs,
+    so views go wherever a read-only operand does: comparison, source of
+    addition, subtraction and multiplication.
+*/
+class VTBignumView
+{
+public:
+    typedef VTLimbs::limb_t limb_t;
+
+    // zero
+    VTBignumView(): _data(0), _limbs(0), _sign(0) {}
+    // n limbs at data, leading zero limbs are skipped; negative if sign is not 0
+    VTBignumView(const limb_t* data, int n, int sign = 0)
+        : _data(data), _limbs(VTLimbs::normalized_size(data, n)), _sign(sign != 0 && _limbs > 0 ? 1 : 0)
+    {}
+    // limbs of bignum, valid until it is changed or destroyed
+    VTBignumView(const VTBignum& bignum);
+
+    inline const limb_t* data() const { return _data; }
+    inline int limbs() const { return _limbs; }
+    // limb at index, least significant first; 0 past limbs()
+    inline limb_t limb(int index) const { return index < _limbs ? _data[index] : 0; }
+    // 0 for + (and zero); 1 for -
+    inline char sign() const { return _sign; }
+
+    // -1, 0 or 1 as lhs is less than, equal to or greater than rhs
+    static int compare(const VTBignumView& lhs, const VTBignumView& rhs);
+
+    // mixed with VTBignum on either side, VTBignum with VTBignum keeps its own operators
+    friend bool operator==(const VTBignumView& lhs, const VTBignumView& rhs) { return compare(lhs, rhs) == 0; }
+    friend bool operator!=(const VTBignumView& lhs, const VTBignumView& rhs) { return compare(lhs, rhs) != 0; }
+    friend bool operator<(const VTBignumView& lhs, const VTBignumView& rhs) { return compare(lhs, rhs) < 0; }
+    friend bool operator>(const VTBignumView& lhs, const VTBignumView& rhs) { return compare(lhs, rhs) > 0; }
+    friend bool operator<=(const VTBignumView& lhs, const VTBignumView& rhs) { return compare(lhs, rhs) <= 0; }
+    friend bool operator>=(const VTBignumView& lhs, const VTBignumView& rhs) { return compare(lhs, rhs) >= 0; }
+
+    friend VTBignum operator+(const VTBignumView& lhs, const VTBignumView& rhs);
+    friend VTBignum operator-(const VTBignumView& lhs, const VTBignumView& rhs);
+    friend VTBignum operator*(const VTBignumView& lhs, const VTBignumView& rhs);
+
+private:
+    const limb_t* _data;
+    int _limbs;
+    char _sign;     // 0 for +; 1 for -
+};
 
 /*
     Class for handling arbitrary precision integers.
 
-    Stores integer in the array of bytes represented as base 256 number.
+    Stores integer in the array of 64-bit machine words (limbs)
+    represented as base 2^64 number, least significant limb first.
+    Zero is stored as an empty array with positive sign.
+    Up to VTBIGNUM_INLINE_LIMBS limbs are kept inside the object,
+    longer numbers are allocated by VTBIGNUM_ALLOCATOR.
 */
 class VTBignum
 {
 public:
     enum Base {Base_10 = 10, Base_16 = 16, Base_256 = 256};
 
+    // layout of arrays of words for fromWords / toWords: order of the words
+    // in the array, and of the bytes in every word
+    enum WordOrder {Order_least_first, Order_most_first};
+    enum Endian {Endian_little, Endian_big, Endian_native};
+
+    typedef VTLimbs::limb_t limb_t;
+
+    /*
+        Product of two numbers, evaluated where it is used. operator* of two
+        named numbers returns it, and assigning it, adding it to or subtracting
+        it from a number runs a single multiply-accumulate pass into the
+        destination, e.g. acc += a * b needs no temporary for the product.
+        It refers to the operands, so it must not outlive the full expression.
+    */
+    class Product
+    {
+    public:
+        Product(const VTBignum& lhs, const VTBignum& rhs): a(lhs), b(rhs) {}
+        operator VTBignum() const;
+
+        const VTBignum& a;
+        const VTBignum& b;
+    };
+
     VTBignum();
     VTBignum(const VTBignum& other);
-    VTBignum& operator=(VTBignum rhs);
+    VTBignum& operator=(const VTBignum& rhs);
+#if defined(VT_HAS_RVALUE_REFERENCES)
+    // limbs are taken over, moved from number is left zero
+    VTBignum(VTBignum&& other);
+    VTBignum& operator=(VTBignum&& rhs);
+#endif
     ~VTBignum();
 
     // return size in bytes, needed to store the number without a sign
-    inline int size() const { return _chunks.size(); }
+    int size() const;
+
+    // return number of limbs used by the magnitude (0 for zero)
+    inline int limbs() const { return static_cast<int>(_chunks.size()); }
+    // return limb of the magnitude at index, least significant first; 0 past limbs()
+    inline limb_t limb(int index) const { return index < limbs() ? _chunks[index] : 0; }
 
     // View the n unsigned bytes as an integer in base 256,
     // and return a VTBignum with the same numeric value
     static VTBignum fromByteArray(const unsigned char* bytes, int size, int sign = 0);
 
+    // magnitude from n limbs, least significant first
+    static VTBignum fromLimbs(const limb_t* limbs, int n, int sign = 0);
+
+    // copy of the number seen by view
+    static VTBignum fromView(const VTBignumView& view);
+
+    // magnitude from count words of word_size bytes each, laid out as order and endian say;
+    // layouts that match the limbs (or their reverse) are copied a limb at a time
+    static VTBignum fromWords(const void* words, int count, int word_size, WordOrder order, Endian endian, int sign = 0);
+
     static VTBignum fromInt(int value);
     static VTBignum fromLongLong(long long value);
 
-    // read number from string (accept Base_10 and Base_16 enums)
+    // read number from string (accept Base_10 and Base_16 enums, hex digits in either case)
     // throws std::runtime_error if encounters unknows characters
-    // size is provided if string is not null-terminated
-    static VTBignum fromString(const char* char_array, int size = MAX_STRING, Base base = Base_10);
+    // size is provided if string is not null-terminated, negative size reads up to the null
+    static VTBignum fromString(const char* char_array, int size = -1, Base base = Base_10);
 
     // return the sign, and store the bytes as an integer in base 256 
     // in array of bytes from the least significant to the most significant bytes
     char toByteArray(unsigned char* bytes) const;
 
+    // return number of words of word_size bytes needed to store the magnitude (0 for zero)
+    int words(int word_size) const;
+
+    // return the sign, and store the magnitude into count words of word_size bytes at words,
+    // padded with zeros; throws std::runtime_error if it needs more than count words
+    char toWords(void* words, int count, int word_size, WordOrder order, Endian endian) const;
+
     // returns long long representation of current number if it fits;
     // otherwise throws std::runtime_error
     long long toLongLong() const;
@@ -76,40 +201,190 @@ public:
     // for integers with bases greater than 16, digits are separated with dot
     std::string toString(int base = Base_10) const;
 
+    // write the number in base 2 to 16 like toString (but with no leading zero in base 16),
+    // through a small buffer, so that the text of long numbers is never in memory as a whole;
+    // throws std::runtime_error if writing fails
+    void write_to(FILE* file, int base = Base_10) const;
+    void write_to(int fd, int base = Base_10) const;
+
+    // read a number in base 2 to 16 like fromString, after optional white space, through
+    // a small buffer; the file is left at the first character after the number, the fd
+    // is read to its end and may only have white space after the number;
+    // throws std::runtime_error if there is no number or on other characters or if reading fails
+    static VTBignum read_from(FILE* file, int base = Base_10);
+    static VTBignum read_from(int fd, int base = Base_10);
+
+    // binary file, see VTMappedBignum.cpp: header with sign, limb count and checksum,
+    // then the limbs little-endian; throws std::runtime_error if the file can not be written
+    void save(const char* path) const;
+    // load a file written by save, the file is mapped into memory and its limbs are copied in bulk,
+    // on big-endian machines they are read and put together byte by byte instead;
+    // throws std::runtime_error if it can not be read, is not in the format or its checksum is wrong
+    static VTBignum load(const char* path);
+
+    // stream I/O in base 10, 16 or 8 as set by std::dec, std::hex or std::oct, streamed
+    // like write_to and read_from; input sets failbit if there is no number; output follows
+    // width, fill, adjustfield, uppercase and showbase like an int, only a padded number is buffered
+    friend std::ostream& operator<<(std::ostream& out, const VTBignum& bignum);
+    friend std::istream& operator>>(std::istream& in, VTBignum& bignum);
+
     VTBignum& operator+=(const VTBignum &rhs);
-    const VTBignum operator+(const VTBignum &other) const;
+    friend VTBignum operator+(const VTBignum& lhs, const VTBignum& rhs);
 
     VTBignum& operator-=(const VTBignum &rhs);
-    const VTBignum operator-(const VTBignum &other) const;
+    friend VTBignum operator-(const VTBignum& lhs, const VTBignum& rhs);
 
     VTBignum& operator*=(const VTBignum &rhs);
-    const VTBignum operator*(const VTBignum &other) const;
+    friend Product operator*(const VTBignum& lhs, const VTBignum& rhs);
 
-    // Not implemented
-    /*
+    // operands viewed in place, see VTBignumView
+    VTBignum& operator+=(const VTBignumView& rhs);
+    VTBignum& operator-=(const VTBignumView& rhs);
+    VTBignum& operator*=(const VTBignumView& rhs);
+
+    // fused operations with a product
+    VTBignum& operator=(const Product& product);
+    VTBignum& operator+=(const Product& product);
+    VTBignum& operator-=(const Product& product);
+    friend VTBignum operator+(const Product& lhs, const VTBignum& rhs);
+    friend VTBignum operator+(const VTBignum& lhs, const Product& rhs);
+    friend VTBignum operator+(const Product& lhs, const Product& rhs);
+    friend VTBignum operator-(const Product& lhs, const VTBignum& rhs);
+    friend VTBignum operator-(const VTBignum& lhs, const Product& rhs);
+    friend VTBignum operator-(const Product& lhs, const Product& rhs);
+
+    // division truncates towards zero and remainder has the sign of dividend,
+    // like for built-in integers; throw std::runtime_error on division by zero
     VTBignum& operator/=(const VTBignum &rhs);
-    const VTBignum operator/(const VTBignum &other) const;
-    
+    friend VTBignum operator/(const VTBignum& lhs, const VTBignum& rhs);
 
-    VTBignum pow_modulo(const VTBignum& power, const VTBignum& mod);
-    */
+    VTBignum& operator%=(const VTBignum &rhs);
+    friend VTBignum operator%(const VTBignum& lhs, const VTBignum& rhs);
+
+#if defined(VT_HAS_RVALUE_REFERENCES)
+    // an expiring operand is reused for the result, so that expression chains
+    // like a * b + c - d do not copy intermediate results
+    friend VTBignum operator+(VTBignum&& lhs, const VTBignum& rhs);
+    friend VTBignum operator+(const VTBignum& lhs, VTBignum&& rhs);
+    friend VTBignum operator+(VTBignum&& lhs, VTBignum&& rhs);
+
+    friend VTBignum operator-(VTBignum&& lhs, const VTBignum& rhs);
+    friend VTBignum operator-(const VTBignum& lhs, VTBignum&& rhs);
+    friend VTBignum operator-(VTBignum&& lhs, VTBignum&& rhs);
+
+    friend VTBignum operator+(const Product& lhs, VTBignum&& rhs);
+    friend VTBignum operator+(VTBignum&& lhs, const Product& rhs);
+    friend VTBignum operator-(const Product& lhs, VTBignum&& rhs);
+    friend VTBignum operator-(VTBignum&& lhs, const Product& rhs);
+
+    // product of a temporary is computed right away, so that it does not
+    // refer to an operand that is gone; product can not be written over
+    // an operand, these only save the copy
+    friend VTBignum operator*(VTBignum&& lhs, const VTBignum& rhs);
+    friend VTBignum operator*(const VTBignum& lhs, VTBignum&& rhs);
+    friend VTBignum operator*(VTBignum&& lhs, VTBignum&& rhs);
+#endif
+
+    // compute both quotient and remainder in one pass,
+    // quotient and remainder may be the same objects as dividend or divisor
+    static void divmod(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder);
+
+    // square in place; also used by x * x and x *= x, which see the same operand twice
+    VTBignum& sqr();
 
     VTBignum& pow(unsigned long long power);
 
-    VTBignum& VTBignum::operator++(); // prefix
-    VTBignum VTBignum::operator++(int unused); // postfix
-    VTBignum& VTBignum::operator--(); // prefix
-    VTBignum VTBignum::operator--(int unused); // postfix
+    // product of the integers (that fit long long) or VTBignums in [begin, end), 1 for an empty range;
+    // balanced binary splitting, so that the long multiplications get operands of similar length,
+    // subtrees run in parallel with VTLimbs::set_threads()
+    template <class Iterator>
+    static VTBignum product(Iterator begin, Iterator end)
+    {
+        std::vector<VTBignum> factors;
+        for (; begin != end; ++begin)
+            factors.push_back(factor(*begin));
+        return product_tree(factors);
+    }
+
+    // n! by prime swing, throw std::runtime_error if n is negative
+    static VTBignum factorial(int n);
+
+    // n choose k from the prime factorisation, 0 unless 0 <= k <= n;
+    // throw std::runtime_error if n is negative
+    static VTBignum binomial(int n, int k);
+
+    // return this^power mod |mod| in range [0, |mod|); power must not be negative,
+    // throw std::runtime_error otherwise or if mod is zero
+    VTBignum pow_modulo(const VTBignum& power, const VTBignum& mod) const;
+
+    // greatest common divisor of |a| and |b|, never negative; gcd(0, 0) is 0
+    static VTBignum gcd(const VTBignum& a, const VTBignum& b);
+
+    // return g = gcd(a, b), and store s and t with g == a * s + b * t; like in GMP,
+    // |s| < |b| / (2g) and |t| < |a| / (2g), except that s = 0, t = sign(b) if |a| == |b|,
+    // s = sign(a) if b == 0 or |b| == 2g, and t = sign(b) if a == 0 or |a| == 2g
+    static VTBignum xgcd(const VTBignum& a, const VTBignum& b, VTBignum& s, VTBignum& t);
+
+    // x in range [0, |mod|) with a * x == 1 modulo |mod|, 0 if |mod| is 1;
+    // throw std::runtime_error if mod is zero or a has no inverse
+    static VTBignum modinv(const VTBignum& a, const VTBignum& mod);
+
+    // floor of the square root, with the remainder a - root * root when asked for;
+    // throw std::runtime_error if a is negative
+    static VTBignum isqrt(const VTBignum& a);
+    static VTBignum isqrt(const VTBignum& a, VTBignum& remainder);
+
+    // n-th root truncated towards zero, with the remainder a - root^n of the sign of a, like in GMP;
+    // throw std::runtime_error if n < 1 or if a is negative and n is even
+    static VTBignum iroot(const VTBignum& a, int n);
+    static VTBignum iroot(const VTBignum& a, int n, VTBignum& remainder);
+
+    // true if this is x^k for an integer x and some k > 1; 0, 1 and -1 count, like in GMP
+    bool is_perfect_power() const;
+
+    // multiply / divide by 2^count, division rounds towards minus infinity like >> of ints does;
+    // throw std::runtime_error if count is negative
+    VTBignum& operator<<=(int count);
+    VTBignum& operator>>=(int count);
+    friend VTBignum operator<<(const VTBignum& lhs, int count);
+    friend VTBignum operator>>(const VTBignum& lhs, int count);
 
-    bool operator==(const VTBignum& other) const;
-    bool operator!=(const VTBignum& other) const;
+    // bitwise operations see negative numbers in two's complement with infinitely many
+    // leading ones, like ints and GMP do: -1 has all bits set and ~x == -x - 1
+    VTBignum& operator&=(const VTBignum& rhs);
+    VTBignum& operator|=(const VTBignum& rhs);
+    VTBignum& operator^=(const VTBignum& rhs);
+    friend VTBignum operator&(const VTBignum& lhs, const VTBignum& rhs);
+    friend VTBignum operator|(const VTBignum& lhs, const VTBignum& rhs);
+    friend VTBignum operator^(const VTBignum& lhs, const VTBignum& rhs);
+    friend VTBignum operator~(const VTBignum& bignum);
 
-    bool operator>(const VTBignum& other) const;
-    bool operator<(const VTBignum& other) const;
-    bool operator>=(const VTBignum& other) const;
-    bool operator<=(const VTBignum& other) const;
+    // number of bits of the magnitude, 0 for zero
+    int bit_length() const;
+    // number of set bits, -1 for negative numbers, which have infinitely many
+    int popcount() const;
+    // bit of the two's complement form, see above; throw std::runtime_error if index is negative
+    bool test_bit(int index) const;
+    void set_bit(int index, bool value = true);
+
+    VTBignum& operator++(); // prefix
+    VTBignum operator++(int unused); // postfix
+    VTBignum& operator--(); // prefix
+    VTBignum operator--(int unused); // postfix
+
+    // non-members, so that products convert on either side
+    friend bool operator==(const VTBignum& lhs, const VTBignum& rhs);
+    friend bool operator!=(const VTBignum& lhs, const VTBignum& rhs);
+
+    friend bool operator>(const VTBignum& lhs, const VTBignum& rhs);
+    friend bool operator<(const VTBignum& lhs, const VTBignum& rhs);
+    friend bool operator>=(const VTBignum& lhs, const VTBignum& rhs);
+    friend bool operator<=(const VTBignum& lhs, const VTBignum& rhs);
 
     friend VTBignum operator-(const VTBignum &bignum);
+#if defined(VT_HAS_RVALUE_REFERENCES)
+    friend VTBignum operator-(VTBignum&& bignum);
+#endif
     friend bool operator!(const VTBignum &bignum);
  
 private:
@@ -118,17 +393,97 @@ private:
     inline void invert() { _sign = !_sign; }
     void normilize();
 
-    void add_no_sign(const VTBignum& bignum, int base = Base_256);
-    int compare_no_sign(const VTBignum& other) const;
-    void mult_by_single_digit(VTBignum& accumulator, unsigned char digit, int position, int base = Base_256);
-    
-    static VTBignum complement(const VTBignum& bignum, int size, int base = Base_256);
-    static std::string print(const VTBignum&, int base);
+    // product = a * b, product may be a or b
+    static void multiply(const VTBignumView& a, const VTBignumView& b, VTBignum& product);
+    // this += a * b, or this -= a * b with subtract set; this may be a or b
+    void add_product(const VTBignum& a, const VTBignum& b, bool subtract);
+
+    void add_no_sign(const VTBignumView& bignum);
+    // subtract magnitudes in place, sign is inverted if bignum is bigger
+    void sub_no_sign(const VTBignumView& bignum);
+    int compare_no_sign(const VTBignumView& other) const;
+
+    // this = this op bignum in two's complement
+    enum BitOperation { Bit_and, Bit_or, Bit_xor };
+    void bitwise(BitOperation operation, const VTBignumView& bignum);
+
+    // multiply / truncating divide magnitude by 2^count
+    void shift_left(int count);
+    void shift_right(int count);
+
+    // division of magnitudes, results are positive
+    static void divmod_no_sign(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder);
+    static void divmod_knuth(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder);
+    static void divmod_newton(const VTBignum& dividend, const VTBignum& divisor, VTBignum& quotient, VTBignum& remainder);
+    // divisor is shifted left by shift bits so that its top bit is set, inverse is its reciprocal
+    static void divmod_reciprocal(const VTBignum& dividend, const VTBignum& divisor, const VTBignum& inverse, int shift,
+                                  VTBignum& quotient, VTBignum& remainder);
+    // floor(2^(128 * n) / divisor) for n limbs long divisor with top bit set
+    static VTBignum reciprocal(const VTBignum& divisor);
+
+    inline int bit(int index) const { return static_cast<int>((_chunks[index / VTLimbs::LIMB_BITS] >> (index % VTLimbs::LIMB_BITS)) & 1); }
+    // modular exponentiation for odd modulus in Montgomery form
+    static VTBignum pow_montgomery(const VTBignum& base, const VTBignum& power, const VTBignum& mod);
+
+    static inline VTBignum factor(long long value) { return fromLongLong(value); }
+    static inline const VTBignum& factor(const VTBignum& value) { return value; }
+    // product of factors, which are destroyed
+    static VTBignum product_tree(std::vector<VTBignum>& factors);
+
+    // products and factorials, see VTProduct.cpp
+    struct ProductTask;
+    static VTBignum multiply_range(VTBignum* factors, const long long* limbs, int count);
+    static VTBignum factorial_swing(int n, const std::vector<char>& primes);
+    // primes[i] != 0 for every prime i <= n
+    static std::vector<char> prime_sieve(int n);
+
+    // greatest common divisors, see VTGcd.cpp
+    struct GcdMatrix;
+    // gcd of magnitudes, with cofactor given it gets s with gcd == s * |a| + t * |b|
+    static VTBignum gcd_reduce(VTBignum a, VTBignum b, VTBignum* cofactor);
+    static void gcd_step(const VTBignum& a, const VTBignum& b, GcdMatrix& step);
+    static bool hgcd(VTBignum& a, VTBignum& b, GcdMatrix& m);
+    static bool hgcd_half(VTBignum& a, VTBignum& b, GcdMatrix& m, int k, int bits);
+    static bool hgcd_lehmer(VTBignum& a, VTBignum& b, GcdMatrix& m, int bits, int steps);
+
+    // floor of the n-th root of a > 0 for n >= 2, see VTRoot.cpp
+    static VTBignum root_floor(const VTBignum& a, int n, VTBignum& remainder);
+
+    // radix conversion, see VTBignum.cpp
+    struct PowerTree;
+    struct DigitSink;
+    static void write_digits(const VTBignum& number, int level, const PowerTree& tree, DigitSink& out);
+    static VTBignum read_digits(const char* digits, int count, int level, const PowerTree& tree);
+    // value of digit character in bases up to 36, 36 for anything else
+    static inline int digit_value(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+        return 36;
+    }
+
+    // magnitude in base 2 to 256 into out, one digit value per character
+    void write_text(DigitSink& out, int base) const;
+    // number at the start of text in base 2 to 16, false if there are no digits
+    template <class Text>
+    static bool read_text(Text& text, int base, VTBignum& result);
+
+    // digits are stored from the least significant one
+    static std::string print(const std::vector<unsigned char>& digits, int base, char sign);
 
     friend void swap(VTBignum& first, VTBignum& second);
+    friend class VTBignumView;
+    friend VTBignum operator+(const VTBignumView& lhs, const VTBignumView& rhs);
+    friend VTBignum operator-(const VTBignumView& lhs, const VTBignumView& rhs);
+    friend VTBignum operator*(const VTBignumView& lhs, const VTBignumView& rhs);
 
 private:
     char _sign;      // 0 for +; 1 for -
-    std::vector<unsigned char> _chunks;
+    VTLimbs::LimbVector<VTBIGNUM_INLINE_LIMBS, VTBIGNUM_ALLOCATOR> _chunks;
+
+};
 
-};
\ No newline at end of file
+inline VTBignumView::VTBignumView(const VTBignum& bignum)
+    : _data(bignum._chunks.begin()), _limbs(bignum.limbs()), _sign(bignum._sign)
+{}
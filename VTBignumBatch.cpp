@@ -0,0 +1,551 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTBignumBatch.h"
+
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+// x86-64 vector kernels: GCC and Clang compile them with function target attributes,
+// so that the rest of the program does not need -mavx2, MSVC accepts the intrinsics as is
+#if defined(__x86_64__) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define VT_BATCH_X86 1
+#define VT_TARGET_AVX2 __attribute__((target("avx2")))
+#define VT_TARGET_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1910
+#define VT_BATCH_X86 1
+#define VT_TARGET_AVX2
+#define VT_TARGET_AVX512
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+using VTLimbs::limb_t;
+
+namespace
+{
+    VTBignumBatch::Simd detect_simd()
+    {
+#if defined(VT_BATCH_X86) && defined(_MSC_VER) && !defined(__clang__)
+        // the processor must have the instructions and the system must save the registers
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return VTBignumBatch::Simd_none;
+        __cpuid(info, 1);
+        if (!(info[2] & (1 << 27)))         // OSXSAVE
+            return VTBignumBatch::Simd_none;
+        unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+            return VTBignumBatch::Simd_avx512;
+        if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+            return VTBignumBatch::Simd_avx2;
+        return VTBignumBatch::Simd_none;
+#elif defined(VT_BATCH_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return VTBignumBatch::Simd_avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return VTBignumBatch::Simd_avx2;
+        return VTBignumBatch::Simd_none;
+#else
+        return VTBignumBatch::Simd_none;
+#endif
+    }
+
+    // AVX2 multiplication has half the lanes of AVX-512 and is slower than
+    // scalar 64 x 64 bit products for products longer than this, in limbs
+    const int AVX2_MUL_LIMBS = 8;
+
+    const VTBignumBatch::Simd supported_simd = detect_simd();
+    VTBignumBatch::Simd current_simd = supported_simd;
+
+    void check_batches(const VTBignumBatch& a, const VTBignumBatch& b, bool same_limbs)
+    {
+        if (a.count() != b.count() || (same_limbs && a.limbs() != b.limbs()))
+            throw std::runtime_error("Batches do not match");
+    }
+
+    // copy results of lanes from first up to count out of lane buffer
+    template <class T>
+    void store_lanes(T* out, const T* lanes, int first, int count)
+    {
+        memcpy(out + first, lanes, std::min<int>(VTBignumBatch::LANES, count - first) * sizeof(T));
+    }
+
+    /*
+        Scalar versions, number by number
+    */
+
+    void add_scalar(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* carries)
+    {
+        for (int j = 0; j < a.count(); ++j)
+        {
+            limb_t carry = 0;
+            for (int i = 0; i < a.limbs(); ++i)
+                r.limb(j, i) = VTLimbs::add_carry(a.limb(j, i), b.limb(j, i), carry);
+            if (carries)
+                carries[j] = static_cast<unsigned char>(carry);
+        }
+    }
+
+    void sub_scalar(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* borrows)
+    {
+        for (int j = 0; j < a.count(); ++j)
+        {
+            limb_t borrow = 0;
+            for (int i = 0; i < a.limbs(); ++i)
+                r.limb(j, i) = VTLimbs::sub_borrow(a.limb(j, i), b.limb(j, i), borrow);
+            if (borrows)
+                borrows[j] = static_cast<unsigned char>(borrow);
+        }
+    }
+
+    void mul_scalar(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b)
+    {
+        std::vector<limb_t> buffer(2 * (a.limbs() + b.limbs()));
+        limb_t* x = &buffer[0];
+        limb_t* y = x + a.limbs();
+        limb_t* product = y + b.limbs();
+
+        // gather operands for the schoolbook kernel
+        const VTLimbs::limb_t* large = (a.limbs() >= b.limbs() ? x : y);
+        const VTLimbs::limb_t* small = (a.limbs() >= b.limbs() ? y : x);
+        for (int j = 0; j < a.count(); ++j)
+        {
+            for (int i = 0; i < a.limbs(); ++i)
+                x[i] = a.limb(j, i);
+            for (int i = 0; i < b.limbs(); ++i)
+                y[i] = b.limb(j, i);
+            VTLimbs::mul_basecase(product, large, std::max(a.limbs(), b.limbs()), small, std::min(a.limbs(), b.limbs()));
+            for (int i = 0; i < r.limbs(); ++i)
+                r.limb(j, i) = product[i];
+        }
+    }
+
+    void compare_scalar(signed char* result, const VTBignumBatch& a, const VTBignumBatch& b)
+    {
+        for (int j = 0; j < a.count(); ++j)
+        {
+            result[j] = 0;
+            for (int i = a.limbs() - 1; i >= 0 && result[j] == 0; --i)
+            {
+                if (a.limb(j, i) != b.limb(j, i))
+                    result[j] = (a.limb(j, i) > b.limb(j, i) ? 1 : -1);
+            }
+        }
+    }
+
+#if defined(VT_BATCH_X86)
+    /*
+        AVX2 versions, 4 numbers per register. There are no unsigned 64-bit
+        comparisons, so operands are compared with their top bits flipped;
+        carries are kept as lane masks, 0 or all ones.
+    */
+
+    VT_TARGET_AVX2 inline __m256i load_avx2(const limb_t* p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    VT_TARGET_AVX2 inline void store_avx2(limb_t* p, __m256i value)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), value);
+    }
+
+    VT_TARGET_AVX2 inline __m256i less_avx2(__m256i a, __m256i b)
+    {
+        const __m256i top = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+        return _mm256_cmpgt_epi64(_mm256_xor_si256(b, top), _mm256_xor_si256(a, top));
+    }
+
+    VT_TARGET_AVX2 void store_carries_avx2(unsigned char* out, const __m256i* carry, int first, int count)
+    {
+        unsigned char lanes[VTBignumBatch::LANES];
+        for (int k = 0; k < 2; ++k)
+        {
+            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(carry[k]));
+            for (int l = 0; l < 4; ++l)
+                lanes[4 * k + l] = static_cast<unsigned char>((mask >> l) & 1);
+        }
+        store_lanes(out, lanes, first, count);
+    }
+
+    VT_TARGET_AVX2 void add_avx2(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* carries)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            __m256i carry[2] = {zero, zero};
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                for (int k = 0; k < 2; ++k)
+                {
+                    __m256i x = load_avx2(a.row(i) + j + 4 * k);
+                    __m256i y = load_avx2(b.row(i) + j + 4 * k);
+                    __m256i sum = _mm256_add_epi64(x, y);
+                    __m256i overflow = less_avx2(sum, x);
+                    sum = _mm256_sub_epi64(sum, carry[k]);
+                    // adding the carry overflows only to zero
+                    carry[k] = _mm256_or_si256(overflow, _mm256_and_si256(carry[k], _mm256_cmpeq_epi64(sum, zero)));
+                    store_avx2(r.row(i) + j + 4 * k, sum);
+                }
+            }
+            if (carries)
+                store_carries_avx2(carries, carry, j, a.count());
+        }
+    }
+
+    VT_TARGET_AVX2 void sub_avx2(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* borrows)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            __m256i borrow[2] = {zero, zero};
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                for (int k = 0; k < 2; ++k)
+                {
+                    __m256i x = load_avx2(a.row(i) + j + 4 * k);
+                    __m256i y = load_avx2(b.row(i) + j + 4 * k);
+                    __m256i diff = _mm256_sub_epi64(x, y);
+                    __m256i underflow = less_avx2(x, y);
+                    // subtracting the borrow underflows only from zero
+                    underflow = _mm256_or_si256(underflow, _mm256_and_si256(borrow[k], _mm256_cmpeq_epi64(diff, zero)));
+                    diff = _mm256_add_epi64(diff, borrow[k]);
+                    borrow[k] = underflow;
+                    store_avx2(r.row(i) + j + 4 * k, diff);
+                }
+            }
+            if (borrows)
+                store_carries_avx2(borrows, borrow, j, a.count());
+        }
+    }
+
+    VT_TARGET_AVX2 void compare_avx2(signed char* result, const VTBignumBatch& a, const VTBignumBatch& b)
+    {
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            signed char lanes[VTBignumBatch::LANES];
+            for (int k = 0; k < 2; ++k)
+            {
+                // a more significant limb that differs overrides the sign of lower ones
+                __m256i sign = _mm256_setzero_si256();
+                for (int i = 0; i < a.limbs(); ++i)
+                {
+                    __m256i x = load_avx2(a.row(i) + j + 4 * k);
+                    __m256i y = load_avx2(b.row(i) + j + 4 * k);
+                    __m256i greater = less_avx2(y, x);
+                    __m256i less = less_avx2(x, y);
+                    sign = _mm256_blendv_epi8(sign, _mm256_set1_epi64x(1), greater);
+                    sign = _mm256_blendv_epi8(sign, less, less);
+                }
+                limb_t values[4];
+                store_avx2(values, sign);
+                for (int l = 0; l < 4; ++l)
+                    lanes[4 * k + l] = static_cast<signed char>(values[l]);
+            }
+            store_lanes(result, lanes, j, a.count());
+        }
+    }
+
+    /*
+        AVX-512 versions, 8 numbers per register, with unsigned comparisons
+        to lane masks.
+    */
+
+    // all lanes; shifts, products and narrowing go through the zero-masked forms, whose plain
+    // ones pass GCC an undefined source vector that -Wall reports as maybe uninitialised
+    const __mmask8 ALL_LANES = 0xff;
+
+    VT_TARGET_AVX512 void store_carries_avx512(unsigned char* out, __mmask8 carry, int first, int count)
+    {
+        unsigned char lanes[VTBignumBatch::LANES];
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(lanes), _mm512_maskz_cvtepi64_epi8(ALL_LANES, _mm512_maskz_set1_epi64(carry, 1)));
+        store_lanes(out, lanes, first, count);
+    }
+
+    VT_TARGET_AVX512 void add_avx512(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* carries)
+    {
+        const __m512i one = _mm512_set1_epi64(1);
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            __mmask8 carry = 0;
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                __m512i x = _mm512_loadu_si512(a.row(i) + j);
+                __m512i y = _mm512_loadu_si512(b.row(i) + j);
+                __m512i sum = _mm512_add_epi64(x, y);
+                __mmask8 overflow = _mm512_cmplt_epu64_mask(sum, x);
+                sum = _mm512_mask_add_epi64(sum, carry, sum, one);
+                carry = overflow | _mm512_mask_cmpeq_epi64_mask(carry, sum, _mm512_setzero_si512());
+                _mm512_storeu_si512(r.row(i) + j, sum);
+            }
+            if (carries)
+                store_carries_avx512(carries, carry, j, a.count());
+        }
+    }
+
+    VT_TARGET_AVX512 void sub_avx512(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* borrows)
+    {
+        const __m512i one = _mm512_set1_epi64(1);
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            __mmask8 borrow = 0;
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                __m512i x = _mm512_loadu_si512(a.row(i) + j);
+                __m512i y = _mm512_loadu_si512(b.row(i) + j);
+                __m512i diff = _mm512_sub_epi64(x, y);
+                __mmask8 underflow = _mm512_cmplt_epu64_mask(x, y) | _mm512_mask_cmpeq_epi64_mask(borrow, diff, _mm512_setzero_si512());
+                diff = _mm512_mask_sub_epi64(diff, borrow, diff, one);
+                borrow = underflow;
+                _mm512_storeu_si512(r.row(i) + j, diff);
+            }
+            if (borrows)
+                store_carries_avx512(borrows, borrow, j, a.count());
+        }
+    }
+
+    VT_TARGET_AVX512 void compare_avx512(signed char* result, const VTBignumBatch& a, const VTBignumBatch& b)
+    {
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            __m512i sign = _mm512_setzero_si512();
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                __m512i x = _mm512_loadu_si512(a.row(i) + j);
+                __m512i y = _mm512_loadu_si512(b.row(i) + j);
+                sign = _mm512_mask_mov_epi64(sign, _mm512_cmpgt_epu64_mask(x, y), _mm512_set1_epi64(1));
+                sign = _mm512_mask_mov_epi64(sign, _mm512_cmplt_epu64_mask(x, y), _mm512_set1_epi64(-1));
+            }
+            signed char lanes[VTBignumBatch::LANES];
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(lanes), _mm512_maskz_cvtepi64_epi8(ALL_LANES, sign));
+            store_lanes(result, lanes, j, a.count());
+        }
+    }
+
+    /*
+        Vector multiplication has only 32 x 32 -> 64 bit products, so
+        operands are split into 32-bit digits and multiplied column by
+        column (product scanning). Low and high halves of the digit products
+        of a column are summed separately, which can not overflow 64 bits,
+        and the high sum goes into the next column.
+    */
+    VT_TARGET_AVX512 void mul_avx512(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b)
+    {
+        const int an = 2 * a.limbs(), bn = 2 * b.limbs();
+        const __m512i low = _mm512_set1_epi64(0xffffffffLL);
+
+        // digits of the operands, a register of them at every LANES limbs
+        VTLimbs::ScratchFrame frame;
+        limb_t* x = frame.alloc((an + bn) * VTBignumBatch::LANES);
+        limb_t* y = x + an * VTBignumBatch::LANES;
+
+        for (int j = 0; j < a.count(); j += VTBignumBatch::LANES)
+        {
+            // multiplication takes the low 32 bits of lanes, even digits need no masking
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                __m512i limbs = _mm512_loadu_si512(a.row(i) + j);
+                _mm512_storeu_si512(x + 2 * i * VTBignumBatch::LANES, limbs);
+                _mm512_storeu_si512(x + (2 * i + 1) * VTBignumBatch::LANES, _mm512_maskz_srli_epi64(ALL_LANES, limbs, 32));
+            }
+            for (int i = 0; i < b.limbs(); ++i)
+            {
+                __m512i limbs = _mm512_loadu_si512(b.row(i) + j);
+                _mm512_storeu_si512(y + 2 * i * VTBignumBatch::LANES, limbs);
+                _mm512_storeu_si512(y + (2 * i + 1) * VTBignumBatch::LANES, _mm512_maskz_srli_epi64(ALL_LANES, limbs, 32));
+            }
+
+            __m512i carry = _mm512_setzero_si512();     // high sum of the previous column with the carry
+            __m512i even = carry;
+            for (int column = 0; column < an + bn; ++column)
+            {
+                __m512i low_sum = carry, high_sum = _mm512_setzero_si512();
+                for (int i = std::max(0, column - bn + 1); i <= std::min(column, an - 1); ++i)
+                {
+                    __m512i x_digit = _mm512_loadu_si512(x + i * VTBignumBatch::LANES);
+                    __m512i y_digit = _mm512_loadu_si512(y + (column - i) * VTBignumBatch::LANES);
+                    __m512i product = _mm512_maskz_mul_epu32(ALL_LANES, x_digit, y_digit);
+                    low_sum = _mm512_add_epi64(low_sum, _mm512_and_si512(product, low));
+                    high_sum = _mm512_add_epi64(high_sum, _mm512_maskz_srli_epi64(ALL_LANES, product, 32));
+                }
+                carry = _mm512_add_epi64(high_sum, _mm512_maskz_srli_epi64(ALL_LANES, low_sum, 32));
+                if (column % 2 == 0)
+                    even = _mm512_and_si512(low_sum, low);
+                else
+                    _mm512_storeu_si512(r.row(column / 2) + j, _mm512_or_si512(even, _mm512_maskz_slli_epi64(ALL_LANES, low_sum, 32)));
+            }
+        }
+    }
+
+    VT_TARGET_AVX2 void mul_avx2(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b)
+    {
+        const int an = 2 * a.limbs(), bn = 2 * b.limbs();
+        const __m256i low = _mm256_set1_epi64x(0xffffffffLL);
+
+        // digits of the operands, a register of them at every LANES limbs
+        VTLimbs::ScratchFrame frame;
+        limb_t* x = frame.alloc((an + bn) * VTBignumBatch::LANES);
+        limb_t* y = x + an * VTBignumBatch::LANES;
+
+        for (int j = 0; j < a.count(); j += 4)
+        {
+            // multiplication takes the low 32 bits of lanes, even digits need no masking
+            for (int i = 0; i < a.limbs(); ++i)
+            {
+                __m256i limbs = load_avx2(a.row(i) + j);
+                store_avx2(x + 2 * i * VTBignumBatch::LANES, limbs);
+                store_avx2(x + (2 * i + 1) * VTBignumBatch::LANES, _mm256_srli_epi64(limbs, 32));
+            }
+            for (int i = 0; i < b.limbs(); ++i)
+            {
+                __m256i limbs = load_avx2(b.row(i) + j);
+                store_avx2(y + 2 * i * VTBignumBatch::LANES, limbs);
+                store_avx2(y + (2 * i + 1) * VTBignumBatch::LANES, _mm256_srli_epi64(limbs, 32));
+            }
+
+            __m256i carry = _mm256_setzero_si256();
+            __m256i even = carry;
+            for (int column = 0; column < an + bn; ++column)
+            {
+                __m256i low_sum = carry, high_sum = _mm256_setzero_si256();
+                for (int i = std::max(0, column - bn + 1); i <= std::min(column, an - 1); ++i)
+                {
+                    __m256i x_digit = load_avx2(x + i * VTBignumBatch::LANES);
+                    __m256i y_digit = load_avx2(y + (column - i) * VTBignumBatch::LANES);
+                    __m256i product = _mm256_mul_epu32(x_digit, y_digit);
+                    low_sum = _mm256_add_epi64(low_sum, _mm256_and_si256(product, low));
+                    high_sum = _mm256_add_epi64(high_sum, _mm256_srli_epi64(product, 32));
+                }
+                carry = _mm256_add_epi64(high_sum, _mm256_srli_epi64(low_sum, 32));
+                if (column % 2 == 0)
+                    even = _mm256_and_si256(low_sum, low);
+                else
+                    store_avx2(r.row(column / 2) + j, _mm256_or_si256(even, _mm256_slli_epi64(low_sum, 32)));
+            }
+        }
+    }
+#endif
+}
+
+VTBignumBatch::VTBignumBatch(int count, int limbs): _count(count), _limbs(limbs),
+    _stride((count + LANES - 1) / LANES * LANES), _data(static_cast<size_t>(_stride) * limbs, 0)
+{}
+
+void VTBignumBatch::set(int number, const VTBignum& value)
+{
+    if (value < VTBignum())
+        throw std::runtime_error("Negative number in batch");
+    if (value.limbs() > _limbs)
+        throw std::runtime_error("Number is too big for batch");
+
+    for (int i = 0; i < _limbs; ++i)
+        limb(number, i) = value.limb(i);
+}
+
+VTBignum VTBignumBatch::get(int number) const
+{
+    std::vector<limb_t> limbs(_limbs + 1);
+    for (int i = 0; i < _limbs; ++i)
+        limbs[i] = limb(number, i);
+    return VTBignum::fromLimbs(&limbs[0], _limbs);
+}
+
+VTBignumBatch::Simd VTBignumBatch::simd()
+{
+    return current_simd;
+}
+
+void VTBignumBatch::set_simd(Simd simd)
+{
+    current_simd = std::min(simd, supported_simd);
+}
+
+void batch_add(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* carries)
+{
+    check_batches(a, b, true);
+    check_batches(r, a, true);
+
+#if defined(VT_BATCH_X86)
+    if (current_simd == VTBignumBatch::Simd_avx512)
+        return add_avx512(r, a, b, carries);
+    if (current_simd == VTBignumBatch::Simd_avx2)
+        return add_avx2(r, a, b, carries);
+#endif
+    add_scalar(r, a, b, carries);
+}
+
+void batch_sub(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* borrows)
+{
+    check_batches(a, b, true);
+    check_batches(r, a, true);
+
+#if defined(VT_BATCH_X86)
+    if (current_simd == VTBignumBatch::Simd_avx512)
+        return sub_avx512(r, a, b, borrows);
+    if (current_simd == VTBignumBatch::Simd_avx2)
+        return sub_avx2(r, a, b, borrows);
+#endif
+    sub_scalar(r, a, b, borrows);
+}
+
+void batch_mul(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b)
+{
+    check_batches(a, b, false);
+    check_batches(r, a, false);
+    if (r.limbs() != a.limbs() + b.limbs())
+        throw std::runtime_error("Batches do not match");
+    if (a.limbs() == 0 || b.limbs() == 0)
+        return;
+
+#if defined(VT_BATCH_X86)
+    if (current_simd == VTBignumBatch::Simd_avx512)
+        return mul_avx512(r, a, b);
+    if (current_simd == VTBignumBatch::Simd_avx2 && r.limbs() <= AVX2_MUL_LIMBS)
+        return mul_avx2(r, a, b);
+#endif
+    mul_scalar(r, a, b);
+}
+
+void batch_compare(signed char* result, const VTBignumBatch& a, const VTBignumBatch& b)
+{
+    check_batches(a, b, true);
+
+#if defined(VT_BATCH_X86)
+    if (current_simd == VTBignumBatch::Simd_avx512)
+        return compare_avx512(result, a, b);
+    if (current_simd == VTBignumBatch::Simd_avx2)
+        return compare_avx2(result, a, b);
+#endif
+    compare_scalar(result, a, b);
+}
@@ -0,0 +1,98 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#pragma once
+
+#include <vector>
+
+#include "VTLimbs.h"
+#include "VTBignum.h"
+
+/*
+    Many unsigned numbers of the same length in limbs, for arithmetic on
+    independent pairs of numbers at once.
+    Limbs are interleaved (structure of arrays): limb i of all numbers is
+    stored contiguously, so that one vector register holds the same limb
+    of consecutive numbers and every lane works on a different number.
+    Count is padded with zero numbers up to a multiple of LANES.
+*/
+class VTBignumBatch
+{
+public:
+    typedef VTLimbs::limb_t limb_t;
+
+    // numbers per widest vector register (AVX-512)
+    enum { LANES = 8 };
+
+    // instruction sets of the batch routines, best one the processor has is picked at first use
+    enum Simd { Simd_none, Simd_avx2, Simd_avx512 };
+
+    // count zero numbers of limbs limbs each
+    VTBignumBatch(int count, int limbs);
+
+    inline int count() const { return _count; }
+    inline int limbs() const { return _limbs; }
+
+    // limb index of number, least significant first
+    inline limb_t& limb(int number, int index) { return _data[index * _stride + number]; }
+    inline limb_t limb(int number, int index) const { return _data[index * _stride + number]; }
+    // limb index of all numbers, padded count of them
+    inline limb_t* row(int index) { return &_data[index * _stride]; }
+    inline const limb_t* row(int index) const { return &_data[index * _stride]; }
+    inline int padded_count() const { return _stride; }
+
+    // throws std::runtime_error if value is negative or longer than limbs()
+    void set(int number, const VTBignum& value);
+    VTBignum get(int number) const;
+
+    // instruction set in use; it can be lowered, e.g. to compare results,
+    // but not raised over what the processor supports
+    static Simd simd();
+    static void set_simd(Simd simd);
+
+private:
+    int _count;
+    int _limbs;
+    int _stride;        // count rounded up to LANES, also distance between rows
+    std::vector<limb_t> _data;
+};
+
+/*
+    Routines on every number of batches, which must have the same count.
+    They throw std::runtime_error if batches do not match.
+*/
+// r = a + b modulo 2^(64 * limbs) for every number; carry out of number i is stored
+// to carries[i] unless carries is NULL; r may be a or b
+void batch_add(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* carries = 0);
+// same as above for r = a - b and borrows
+void batch_sub(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b, unsigned char* borrows = 0);
+// r = a * b for every number, r has a.limbs() + b.limbs() limbs and must not be a or b
+void batch_mul(VTBignumBatch& r, const VTBignumBatch& a, const VTBignumBatch& b);
+// result[i] = sign of a - b for number i
+void batch_compare(signed char* result, const VTBignumBatch& a, const VTBignumBatch& b);
+
@@ -0,0 +1,444 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+/*
+    Benchmarks of VTBignum operations over operand sizes, and of a few
+    applications built on them. Results are printed as JSON (default) or CSV,
+    one record per operation and size:
+        benchmark, size, iterations, ns_per_op
+    Size is the operand length in limbs for operations, n for factorial
+    and the number of digits for pi and e.
+    With --stats, counters of all the runs are printed to stderr; they are
+    collected only when built with VTBIGNUM_STATS, and slow the timings down.
+
+    VTBignumBench [--csv] [--max-limbs N] [--max-digits N] [--min-time seconds]
+                  [--threads N] [--only name] [--stats]
+*/
+#include "VTBignum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+namespace
+{
+    struct Options
+    {
+        bool csv;
+        long long max_limbs;
+        long long max_digits;
+        double min_time;        // every benchmark is repeated for at least this many seconds
+        const char* only;       // run only benchmarks with this name, all if NULL
+    };
+
+    Options options = { false, 100000, 100000, 0.2, NULL };
+    bool first_record = true;
+    volatile int sink = 0;      // results go here, so that they are not optimised out
+
+    double seconds()
+    {
+#if defined(_WIN32)
+        LARGE_INTEGER count, frequency;
+        QueryPerformanceCounter(&count);
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<double>(count.QuadPart) / frequency.QuadPart;
+#else
+        timeval now;
+        gettimeofday(&now, NULL);
+        return now.tv_sec + now.tv_usec * 1e-6;
+#endif
+    }
+
+    void report(const char* name, long long size, int iterations, double ns)
+    {
+        if (options.csv)
+        {
+            printf("%s,%lld,%d,%.1f\n", name, size, iterations, ns);
+        }
+        else
+        {
+            printf("%s\n    {\"benchmark\": \"%s\", \"size\": %lld, \"iterations\": %d, \"ns_per_op\": %.1f}",
+                   first_record ? "" : ",", name, size, iterations, ns);
+        }
+        first_record = false;
+        fflush(stdout);
+    }
+
+    // n random limbs with the top one non-zero
+    VTBignum random_number(long long n, unsigned long long seed)
+    {
+        std::vector<VTLimbs::limb_t> limbs(static_cast<size_t>(n));
+        for (size_t i = 0; i < limbs.size(); ++i)
+        {
+            // xorshift64
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            limbs[i] = seed;
+        }
+        limbs.back() |= 1ULL << 63;
+        return VTBignum::fromLimbs(&limbs[0], static_cast<int>(n));
+    }
+
+    // operands of one size, strings are made only for the benchmarks that read them
+    struct Operands
+    {
+        long long size;
+        VTBignum a;
+        VTBignum b;
+        VTBignum negative_b;
+        VTBignum a_plus_1;      // same length as a, differs in the lowest limb
+        VTBignum result;
+        std::string decimal;
+        std::string hex;
+        std::vector<unsigned char> bytes;
+    };
+
+    void run_add(Operands& x) { x.result = x.a + x.b; }
+    void run_sub(Operands& x) { x.result = x.a - x.b; }
+    void run_add_mixed(Operands& x) { x.result = x.a + x.negative_b; }
+    void run_mul(Operands& x) { x.result = x.a * x.b; }
+    void run_sqr(Operands& x) { x.result = x.a; x.result.sqr(); }
+    // a limb to the power of the size, so that the result has size limbs
+    void run_pow(Operands& x) { x.result = VTBignum::fromLongLong(static_cast<long long>(x.a.limb(0) >> 1) | 1); x.result.pow(x.size); }
+    void run_to_string_10(Operands& x) { sink += static_cast<int>(x.a.toString(10).size()); }
+    void run_to_string_16(Operands& x) { sink += static_cast<int>(x.a.toString(16).size()); }
+    void run_to_string_256(Operands& x) { sink += static_cast<int>(x.a.toString(256).size()); }
+    void run_from_string_10(Operands& x) { x.result = VTBignum::fromString(x.decimal.c_str(), static_cast<int>(x.decimal.size())); }
+    void run_from_string_16(Operands& x) { x.result = VTBignum::fromString(x.hex.c_str(), static_cast<int>(x.hex.size()), VTBignum::Base_16); }
+    void run_from_bytes(Operands& x) { x.result = VTBignum::fromByteArray(&x.bytes[0], static_cast<int>(x.bytes.size())); }
+    void run_compare(Operands& x) { sink += (x.a < x.a_plus_1) + (x.a == x.a_plus_1); }
+    void run_to_long_long(Operands& x) { sink += static_cast<int>(x.result.toLongLong()); }
+
+    // return false if the benchmark does not apply to the size
+    bool prepare_none(Operands&) { return true; }
+    bool prepare_decimal(Operands& x) { x.decimal = x.a.toString(10); return true; }
+    bool prepare_hex(Operands& x) { x.hex = x.a.toString(16); return true; }
+    bool prepare_bytes(Operands& x)
+    {
+        x.bytes.resize(x.a.size());
+        x.a.toByteArray(&x.bytes[0]);
+        return true;
+    }
+    bool prepare_long_long(Operands& x)
+    {
+        x.result = VTBignum::fromLongLong(static_cast<long long>(x.a.limb(0) >> 1));
+        return x.size == 1;
+    }
+
+    struct Operation
+    {
+        const char* name;
+        void (*run)(Operands& x);
+        bool (*prepare)(Operands& x);
+    };
+
+    const Operation operations[] =
+    {
+        { "add", run_add, prepare_none },
+        { "sub", run_sub, prepare_none },
+        { "add_mixed_sign", run_add_mixed, prepare_none },
+        { "mul", run_mul, prepare_none },
+        { "sqr", run_sqr, prepare_none },
+        { "pow", run_pow, prepare_none },
+        { "to_string_10", run_to_string_10, prepare_none },
+        { "to_string_16", run_to_string_16, prepare_none },
+        { "to_string_256", run_to_string_256, prepare_none },
+        { "from_string_10", run_from_string_10, prepare_decimal },
+        { "from_string_16", run_from_string_16, prepare_hex },
+        { "from_byte_array", run_from_bytes, prepare_bytes },
+        { "compare", run_compare, prepare_none },
+        { "to_long_long", run_to_long_long, prepare_long_long },
+    };
+
+    bool selected(const char* name)
+    {
+        return options.only == NULL || strcmp(options.only, name) == 0;
+    }
+
+    void measure(const Operation& operation, Operands& x)
+    {
+        // batches double, so that reading the clock costs little next to short operations
+        int iterations = 0;
+        int batch = 1;
+        double start = seconds();
+        double elapsed;
+        do
+        {
+            for (int i = 0; i < batch; ++i)
+                operation.run(x);
+            iterations += batch;
+            batch *= 2;
+            elapsed = seconds() - start;
+        } while (elapsed < options.min_time);
+
+        sink += x.result.limbs();
+        report(operation.name, x.size, iterations, elapsed * 1e9 / iterations);
+    }
+
+    // 1, 3, 10, 30, 100, ...
+    inline long long next_size(long long size) { return size % 3 == 0 ? size / 3 * 10 : size * 3; }
+
+    void run_operations()
+    {
+        for (long long size = 1; size <= options.max_limbs; size = next_size(size))
+        {
+            Operands x;
+            x.size = size;
+            x.a = random_number(size, 2 * size + 1);
+            x.b = random_number(size, 2 * size + 2);
+            x.negative_b = -x.b;
+            x.a_plus_1 = x.a;
+            ++x.a_plus_1;
+
+            for (size_t i = 0; i < sizeof(operations) / sizeof(operations[0]); ++i)
+            {
+                if (selected(operations[i].name) && operations[i].prepare(x))
+                    measure(operations[i], x);
+            }
+        }
+    }
+
+    // APPLICATIONS
+
+    // P, Q and T of the terms [a, b) of the Chudnovsky series
+    void chudnovsky(long long a, long long b, VTBignum& p, VTBignum& q, VTBignum& t)
+    {
+        if (b - a == 1)
+        {
+            if (a == 0)
+            {
+                p = VTBignum::fromInt(1);
+                q = VTBignum::fromInt(1);
+            }
+            else
+            {
+                // 640320^3 / 24
+                p = VTBignum::fromLongLong((6 * a - 5) * (2 * a - 1) * (6 * a - 1));
+                q = VTBignum::fromLongLong(a * a) * VTBignum::fromLongLong(a);
+                q *= VTBignum::fromLongLong(10939058860032000LL);
+            }
+            t = p * VTBignum::fromLongLong(13591409 + 545140134 * a);
+            if (a & 1)
+                t = -t;
+            return;
+        }
+
+        long long m = (a + b) / 2;
+        VTBignum p2, q2, t2;
+        chudnovsky(a, m, p, q, t);
+        chudnovsky(m, b, p2, q2, t2);
+        t = t * q2 + p * t2;
+        p *= p2;
+        q *= q2;
+    }
+
+    // floor(sqrt(n)) by Newton's iteration from guess >= sqrt(n)
+    VTBignum isqrt(const VTBignum& n, VTBignum guess)
+    {
+        const VTBignum two = VTBignum::fromInt(2);
+        for (;;)
+        {
+            VTBignum next = (guess + n / guess) / two;
+            if (next >= guess)
+                return guess;
+            guess = next;
+        }
+    }
+
+    // floor(pi * 10^digits)
+    VTBignum pi(long long digits)
+    {
+        VTBignum p, q, t;
+        chudnovsky(0, digits / 14 + 2, p, q, t);
+
+        VTBignum one = VTBignum::fromInt(10);
+        one.pow(digits);
+        VTBignum sqrt_c = isqrt(VTBignum::fromInt(10005) * one * one, VTBignum::fromInt(101) * one);
+        return VTBignum(q * VTBignum::fromInt(426880)) * sqrt_c / t;
+    }
+
+    // Q and T of the terms 1 / k! for k in (a, b]: T / Q is their sum times a!
+    void e_series(long long a, long long b, VTBignum& q, VTBignum& t)
+    {
+        if (b - a == 1)
+        {
+            q = VTBignum::fromLongLong(b);
+            t = VTBignum::fromInt(1);
+            return;
+        }
+
+        long long m = (a + b) / 2;
+        VTBignum q2, t2;
+        e_series(a, m, q, t);
+        e_series(m, b, q2, t2);
+        t = t * q2 + t2;
+        q *= q2;
+    }
+
+    // floor(e * 10^digits)
+    VTBignum e(long long digits)
+    {
+        // terms up to 1 / n! with n! > 10^(digits + 2)
+        long long n = 1;
+        for (double log_factorial = 0; log_factorial < digits + 2; ++n)
+            log_factorial += log10(static_cast<double>(n + 1));
+
+        VTBignum q, t;
+        e_series(0, n, q, t);
+        VTBignum one = VTBignum::fromInt(10);
+        one.pow(digits);
+        return VTBignum(q + t) * one / q;
+    }
+
+    bool starts_with(const std::string& text, const char* prefix)
+    {
+        return text.compare(0, strlen(prefix), prefix) == 0;
+    }
+
+    void run_applications()
+    {
+        for (long long n = 1000; n <= options.max_digits; n *= 10)
+        {
+            double start;
+            if (selected("factorial"))
+            {
+                start = seconds();
+                sink += VTBignum::factorial(static_cast<int>(n)).limbs();
+                report("factorial", n, 1, (seconds() - start) * 1e9);
+            }
+
+            if (selected("pi"))
+            {
+                start = seconds();
+                VTBignum digits = pi(n);
+                report("pi", n, 1, (seconds() - start) * 1e9);
+                if (!starts_with(digits.toString(), "31415926535897932384"))
+                {
+                    fprintf(stderr, "wrong digits of pi\n");
+                    exit(1);
+                }
+            }
+
+            if (selected("e"))
+            {
+                start = seconds();
+                VTBignum digits = e(n);
+                report("e", n, 1, (seconds() - start) * 1e9);
+                if (!starts_with(digits.toString(), "27182818284590452353"))
+                {
+                    fprintf(stderr, "wrong digits of e\n");
+                    exit(1);
+                }
+            }
+        }
+    }
+
+    void print_stats()
+    {
+        VTLimbs::Stats stats = VTLimbs::stats_snapshot();
+        fprintf(stderr, "%-16s %12s %14s %12s %14s\n", "operation", "calls", "limbs", "allocations", "bytes");
+        for (int i = 0; i < VTLimbs::STAT_OPERATIONS; ++i)
+        {
+            const VTLimbs::Stats::Operation& o = stats.operations[i];
+            fprintf(stderr, "%-16s %12llu %14llu %12llu %14llu\n", VTLimbs::stat_name(static_cast<VTLimbs::StatOperation>(i)),
+                    o.calls, o.limbs, o.allocations, o.allocated_bytes);
+        }
+        fprintf(stderr, "\n%-16s %12s %14s\n", "tier", "calls", "ms");
+        for (int i = 0; i < VTLimbs::STAT_TIERS; ++i)
+        {
+            const VTLimbs::Stats::Tier& t = stats.tiers[i];
+            fprintf(stderr, "%-16s %12llu %14.1f\n", VTLimbs::stat_name(static_cast<VTLimbs::StatTier>(i)),
+                    t.calls, t.nanoseconds * 1e-6);
+        }
+    }
+
+    void usage()
+    {
+        fprintf(stderr, "usage: VTBignumBench [--csv] [--max-limbs N] [--max-digits N] [--min-time seconds]\n"
+                        "                     [--threads N] [--only name] [--stats]\n");
+        exit(2);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--csv") == 0)
+            options.csv = true;
+        else if (strcmp(argv[i], "--max-limbs") == 0 && has_value)
+            options.max_limbs = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--max-digits") == 0 && has_value)
+            options.max_digits = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--min-time") == 0 && has_value)
+            options.min_time = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && has_value)
+            VTLimbs::set_threads(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--only") == 0 && has_value)
+            options.only = argv[++i];
+        else if (strcmp(argv[i], "--stats") == 0)
+            VTLimbs::set_stats(true);
+        else
+            usage();
+    }
+
+    // thresholds are printed with the results, to compare runs with different crossovers
+    const VTLimbs::Thresholds& t = VTLimbs::thresholds;
+    if (options.csv)
+    {
+        printf("benchmark,size,iterations,ns_per_op\n");
+    }
+    else
+    {
+        printf("{\n  \"threads\": %d,\n", VTLimbs::threads());
+        printf("  \"thresholds\": {\"mul_karatsuba\": %d, \"mul_toom3\": %d, \"mul_ntt\": %d, \"sqr_karatsuba\": %d, "
+               "\"sqr_toom3\": %d, \"div_newton\": %d, \"str_dc\": %d, \"mul_parallel\": %d, \"gcd_dc\": %d},\n",
+               t.mul_karatsuba, t.mul_toom3, t.mul_ntt, t.sqr_karatsuba, t.sqr_toom3, t.div_newton, t.str_dc, t.mul_parallel, t.gcd_dc);
+        printf("  \"results\": [");
+    }
+
+    run_operations();
+    run_applications();
+
+    if (!options.csv)
+        printf("\n  ]\n}\n");
+    if (VTLimbs::stats_enabled())
+        print_stats();
+    return 0;
+}
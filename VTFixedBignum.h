@@ -0,0 +1,277 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+// std::is_constant_evaluated: C++20
+#if __cplusplus > 201703L || (defined(_MSVC_LANG) && _MSVC_LANG > 201703L)
+#include <type_traits>
+#define VT_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+
+#include "VTLimbs.h"
+#include "VTBignum.h"
+
+/*
+    Unsigned integer of Bits bits for values with a known bound, like hashes
+    and field elements. Limbs are kept inside the object, so nothing is
+    allocated and there is no size to track: every loop runs LIMBS times,
+    which lets the compiler unroll it and keep short numbers in registers.
+    Arithmetic wraps around modulo 2^Bits like for built-in unsigned integers,
+    full_product() gives the product without truncation.
+    With VT_HAS_CONSTEXPR everything but conversion to and from VTBignum
+    can be evaluated at compile time.
+*/
+template <int Bits>
+class VTFixedBignum
+{
+public:
+    typedef VTLimbs::limb_t limb_t;
+
+    enum { LIMBS = (Bits + VTLimbs::LIMB_BITS - 1) / VTLimbs::LIMB_BITS };
+
+    VT_CONSTEXPR VTFixedBignum(): _limbs()
+    {}
+
+    // value modulo 2^Bits
+    explicit VT_CONSTEXPR VTFixedBignum(unsigned long long value): _limbs()
+    {
+        _limbs[0] = value;
+        wrap();
+    }
+
+    // n limbs, least significant first; throws std::runtime_error if the value does not fit
+    static VT_CONSTEXPR VTFixedBignum fromLimbs(const limb_t* limbs, int n)
+    {
+        VTFixedBignum result;
+        for (int i = 0; i < n; ++i)
+        {
+            if (i < LIMBS)
+                result._limbs[i] = limbs[i];
+            else if (limbs[i] != 0)
+                throw std::runtime_error("Number is too big for VTFixedBignum");
+        }
+        if (result.wrap())
+            throw std::runtime_error("Number is too big for VTFixedBignum");
+        return result;
+    }
+
+    // read number from string in base 10 or 16 without sign, size as for VTBignum::fromString;
+    // throws std::runtime_error on unknown characters or if the value does not fit
+    static VT_CONSTEXPR VTFixedBignum fromString(const char* char_array, int size = -1, VTBignum::Base base = VTBignum::Base_10)
+    {
+        VTFixedBignum result;
+        for (int i = 0; (size < 0 || i < size) && char_array[i] != '\0'; ++i)
+        {
+            limb_t carry = digit_value(char_array[i]);
+            if (carry >= static_cast<limb_t>(base))
+                throw std::runtime_error("Wrong character in number");
+
+            for (int j = 0; j < LIMBS; ++j)
+                result._limbs[j] = mul_add(result._limbs[j], base, carry, 0, carry);
+            if (carry != 0 || result.wrap())
+                throw std::runtime_error("Number is too big for VTFixedBignum");
+        }
+        return result;
+    }
+
+    // throws std::runtime_error if bignum is negative or does not fit
+    static VTFixedBignum fromBignum(const VTBignum& bignum)
+    {
+        if (bignum < VTBignum())
+            throw std::runtime_error("Negative number for VTFixedBignum");
+
+        VTFixedBignum result;
+        for (int i = 0; i < bignum.limbs(); ++i)
+        {
+            if (i >= LIMBS)
+                throw std::runtime_error("Number is too big for VTFixedBignum");
+            result._limbs[i] = bignum.limb(i);
+        }
+        if (result.wrap())
+            throw std::runtime_error("Number is too big for VTFixedBignum");
+        return result;
+    }
+
+    VTBignum toBignum() const
+    {
+        return VTBignum::fromLimbs(_limbs, LIMBS);
+    }
+
+    std::string toString(int base = VTBignum::Base_10) const
+    {
+        return toBignum().toString(base);
+    }
+
+    // limb at index, least significant first
+    VT_CONSTEXPR limb_t limb(int index) const { return _limbs[index]; }
+
+    VT_CONSTEXPR VTFixedBignum& operator+=(const VTFixedBignum& rhs)
+    {
+        limb_t carry = 0;
+        for (int i = 0; i < LIMBS; ++i)
+            _limbs[i] = VTLimbs::add_carry(_limbs[i], rhs._limbs[i], carry);
+        wrap();
+        return *this;
+    }
+
+    VT_CONSTEXPR VTFixedBignum& operator-=(const VTFixedBignum& rhs)
+    {
+        limb_t borrow = 0;
+        for (int i = 0; i < LIMBS; ++i)
+            _limbs[i] = VTLimbs::sub_borrow(_limbs[i], rhs._limbs[i], borrow);
+        wrap();
+        return *this;
+    }
+
+    // schoolbook on the limbs below 2^Bits only
+    VT_CONSTEXPR VTFixedBignum& operator*=(const VTFixedBignum& rhs)
+    {
+        VTFixedBignum product;
+        for (int i = 0; i < LIMBS; ++i)
+        {
+            limb_t carry = 0;
+            for (int j = 0; i + j < LIMBS; ++j)
+                product._limbs[i + j] = mul_add(_limbs[i], rhs._limbs[j], product._limbs[i + j], carry, carry);
+        }
+        product.wrap();
+        *this = product;
+        return *this;
+    }
+
+    // product of 2 * Bits bits, never wraps
+    VT_CONSTEXPR VTFixedBignum<2 * Bits> full_product(const VTFixedBignum& rhs) const
+    {
+        limb_t product[2 * LIMBS] = {};
+        for (int i = 0; i < LIMBS; ++i)
+        {
+            limb_t carry = 0;
+            for (int j = 0; j < LIMBS; ++j)
+                product[i + j] = mul_add(_limbs[i], rhs._limbs[j], product[i + j], carry, carry);
+            product[i + LIMBS] = carry;
+        }
+
+        // product is below 2^(2 * Bits), any limbs past the result are zero
+        VTFixedBignum<2 * Bits> result;
+        for (int i = 0; i < VTFixedBignum<2 * Bits>::LIMBS; ++i)
+            result._limbs[i] = product[i];
+        return result;
+    }
+
+    friend VT_CONSTEXPR VTFixedBignum operator+(const VTFixedBignum& lhs, const VTFixedBignum& rhs)
+    {
+        VTFixedBignum result = lhs;
+        result += rhs;
+        return result;
+    }
+
+    friend VT_CONSTEXPR VTFixedBignum operator-(const VTFixedBignum& lhs, const VTFixedBignum& rhs)
+    {
+        VTFixedBignum result = lhs;
+        result -= rhs;
+        return result;
+    }
+
+    friend VT_CONSTEXPR VTFixedBignum operator*(const VTFixedBignum& lhs, const VTFixedBignum& rhs)
+    {
+        VTFixedBignum result = lhs;
+        result *= rhs;
+        return result;
+    }
+
+    friend VT_CONSTEXPR bool operator==(const VTFixedBignum& lhs, const VTFixedBignum& rhs) { return compare(lhs, rhs) == 0; }
+    friend VT_CONSTEXPR bool operator!=(const VTFixedBignum& lhs, const VTFixedBignum& rhs) { return compare(lhs, rhs) != 0; }
+
+    friend VT_CONSTEXPR bool operator>(const VTFixedBignum& lhs, const VTFixedBignum& rhs) { return compare(lhs, rhs) > 0; }
+    friend VT_CONSTEXPR bool operator<(const VTFixedBignum& lhs, const VTFixedBignum& rhs) { return compare(lhs, rhs) < 0; }
+    friend VT_CONSTEXPR bool operator>=(const VTFixedBignum& lhs, const VTFixedBignum& rhs) { return compare(lhs, rhs) >= 0; }
+    friend VT_CONSTEXPR bool operator<=(const VTFixedBignum& lhs, const VTFixedBignum& rhs) { return compare(lhs, rhs) <= 0; }
+
+    friend VT_CONSTEXPR bool operator!(const VTFixedBignum& bignum) { return compare(bignum, VTFixedBignum()) == 0; }
+
+private:
+    template <int OtherBits> friend class VTFixedBignum;
+
+    // clear bits past Bits in the top limb, return whether there were any
+    VT_CONSTEXPR bool wrap()
+    {
+        if (Bits % VTLimbs::LIMB_BITS == 0)
+            return false;
+
+        limb_t mask = (static_cast<limb_t>(1) << (Bits % VTLimbs::LIMB_BITS)) - 1;
+        bool overflow = (_limbs[LIMBS - 1] & ~mask) != 0;
+        _limbs[LIMBS - 1] &= mask;
+        return overflow;
+    }
+
+    // return sign of lhs - rhs
+    static VT_CONSTEXPR int compare(const VTFixedBignum& lhs, const VTFixedBignum& rhs)
+    {
+        for (int i = LIMBS - 1; i >= 0; --i)
+        {
+            if (lhs._limbs[i] != rhs._limbs[i])
+                return lhs._limbs[i] > rhs._limbs[i] ? 1 : -1;
+        }
+        return 0;
+    }
+
+    // VTLimbs::mul_add that can be evaluated at compile time
+    static VT_CONSTEXPR limb_t mul_add(limb_t a, limb_t b, limb_t c, limb_t d, limb_t& hi)
+    {
+#if defined(__SIZEOF_INT128__)
+        VTLimbs::dlimb_t acc = static_cast<VTLimbs::dlimb_t>(a) * b + c + d;
+        hi = static_cast<limb_t>(acc >> VTLimbs::LIMB_BITS);
+        return static_cast<limb_t>(acc);
+#else
+#if defined(VT_HAS_IS_CONSTANT_EVALUATED)
+        if (!std::is_constant_evaluated())
+            return VTLimbs::mul_add(a, b, c, d, hi);
+#endif
+        limb_t lo = VTLimbs::mul_wide_halves(a, b, hi);
+        lo += c;
+        hi += (lo < c);
+        lo += d;
+        hi += (lo < d);
+        return lo;
+#endif
+    }
+
+    // same as VTBignum::digit_value
+    static VT_CONSTEXPR limb_t digit_value(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+        return 36;
+    }
+
+    limb_t _limbs[LIMBS];
+};
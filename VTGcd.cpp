@@ -0,0 +1,488 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTBignum.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace VTLimbs;
+
+/*
+    Greatest common divisors by reductions (a; b) <- M^-1 (a; b) with matrices
+    M of non-negative entries and determinant 1, which keep the gcd.
+    Short numbers take Lehmer steps: Euclid's algorithm on their leading bits
+    gives a matrix of single limbs that is applied to the whole numbers in one
+    pass. Long numbers are reduced by the half-GCD, which finds the matrix for
+    half of the bits from the leading half of the numbers, recursively, and
+    applies it with fast multiplication. Single limbs go through binary GCD.
+*/
+
+namespace
+{
+#if defined(__SIZEOF_INT128__)
+    // leading bits that Lehmer steps look at, two limbs where the compiler has double limbs
+    typedef dlimb_t hat_t;
+#else
+    typedef limb_t hat_t;
+#endif
+    const int HAT_LIMBS = static_cast<int>(sizeof(hat_t) / sizeof(limb_t));
+
+    // bits [shift, shift + HAT_LIMBS * LIMB_BITS) of x
+    hat_t leading_bits(const VTBignum& x, int shift)
+    {
+        limb_t window[HAT_LIMBS + 1];
+        for (int i = 0; i <= HAT_LIMBS; ++i)
+            window[i] = x.limb(shift / LIMB_BITS + i);
+        if (shift % LIMB_BITS != 0)
+            rshift(window, window, HAT_LIMBS + 1, shift % LIMB_BITS);
+#if defined(__SIZEOF_INT128__)
+        return (static_cast<hat_t>(window[1]) << LIMB_BITS) | window[0];
+#else
+        return window[0];
+#endif
+    }
+
+    // r gets n + 1 limbs of a * p - b * q, which must not be negative; a and b have at most n limbs
+    void mul_sub_1(limb_t* r, const limb_t* a, int an, limb_t p, const limb_t* b, int bn, limb_t q, int n)
+    {
+        r[an] = (an > 0 ? mul_1(r, a, an, p) : 0);
+        std::fill(r + an + 1, r + n + 1, 0);
+        if (bn > 0)
+        {
+            limb_t high = submul_1(r, b, bn, q);
+            limb_t borrow = sub_1(r + bn, r + bn, n + 1 - bn, high);
+            assert(borrow == 0);
+            (void)borrow;
+        }
+    }
+
+    // r gets n + 2 limbs of a * p + b * q; a and b have at most n limbs
+    void mul_add_1(limb_t* r, const limb_t* a, int an, limb_t p, const limb_t* b, int bn, limb_t q, int n)
+    {
+        r[an] = (an > 0 ? mul_1(r, a, an, p) : 0);
+        std::fill(r + an + 1, r + n + 2, 0);
+        if (bn > 0)
+        {
+            limb_t high = addmul_1(r, b, bn, q);
+            add_1(r + bn, r + bn, n + 2 - bn, high);
+        }
+    }
+
+    // binary GCD: common factors of two are taken out, then the larger of two odd numbers
+    // is replaced by their difference, which is even
+    limb_t gcd_1(limb_t u, limb_t v)
+    {
+        if (u == 0)
+            return v;
+        if (v == 0)
+            return u;
+
+        int shift = count_trailing_zeros(u | v);
+        u >>= count_trailing_zeros(u);
+        do
+        {
+            v >>= count_trailing_zeros(v);
+            if (u > v)
+                std::swap(u, v);
+            v -= u;
+        } while (v != 0);
+        return u << shift;
+    }
+
+    /*
+        Extended Euclid on single limbs a, b > 0: return g and store magnitudes
+        of s and t with g == s * a + t * b. Cofactors of the remainders alternate
+        in sign, so their magnitudes only grow by addition and stay below b and a;
+        s_negative tells the sign of s, t has the other one.
+    */
+    limb_t xgcd_1(limb_t a, limb_t b, limb_t& s, limb_t& t, bool& s_negative)
+    {
+        limb_t r0 = a, r1 = b;
+        limb_t s0 = 1, s1 = 0;
+        limb_t t0 = 0, t1 = 1;
+        bool odd = false;       // sign of s0 is (-1)^steps
+        while (r1 != 0)
+        {
+            limb_t q = r0 / r1;
+            limb_t r = r0 - q * r1;
+            limb_t sn = s0 + q * s1;
+            limb_t tn = t0 + q * t1;
+            r0 = r1; r1 = r;
+            s0 = s1; s1 = sn;
+            t0 = t1; t1 = tn;
+            odd = !odd;
+        }
+        s = s0;
+        t = t0;
+        s_negative = odd;
+        return r0;
+    }
+}
+
+struct VTBignum::GcdMatrix
+{
+    // (a; b) == m (x; y) for the reduced pair (x; y)
+    VTBignum m[2][2];
+    VTBignum row[2];        // limbs for multiply(), kept between calls
+
+    GcdMatrix()
+    {
+        m[0][0] = fromInt(1);
+        m[1][1] = fromInt(1);
+    }
+
+    bool single_limbs() const
+    {
+        return m[0][0].limbs() <= 1 && m[0][1].limbs() <= 1 && m[1][0].limbs() <= 1 && m[1][1].limbs() <= 1;
+    }
+
+    // this = this * other, in a pass of limb kernels per entry if other has single limbs
+    void multiply(const GcdMatrix& other)
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            if (!other.single_limbs())
+            {
+                row[0] = m[i][0] * other.m[0][0] + m[i][1] * other.m[1][0];
+                row[1] = m[i][0] * other.m[0][1] + m[i][1] * other.m[1][1];
+            }
+            else
+            {
+                const VTBignum& a = m[i][0];
+                const VTBignum& b = m[i][1];
+                int n = std::max(a.limbs(), b.limbs());
+                for (int j = 0; j < 2; ++j)
+                {
+                    row[j]._chunks.resize(n + 2);
+                    mul_add_1(&row[j]._chunks[0], a._chunks.begin(), a.limbs(), other.m[0][j].limb(0),
+                              b._chunks.begin(), b.limbs(), other.m[1][j].limb(0), n);
+                    row[j]._sign = 0;
+                    row[j].normilize();
+                }
+            }
+            swap(m[i][0], row[0]);
+            swap(m[i][1], row[1]);
+        }
+    }
+
+    // (x; y) = m^-1 (a; b) = (m11 a - m01 b; m00 b - m10 a) for any a, b; x, y must not be a or b
+    void reduce(const VTBignum& a, const VTBignum& b, VTBignum& x, VTBignum& y) const
+    {
+        x = m[1][1] * a - m[0][1] * b;
+        y = m[0][0] * b - m[1][0] * a;
+    }
+
+    // reduce() of a pair of magnitudes that m keeps non-negative,
+    // in a pass of limb kernels per number if the entries are single limbs
+    void reduce_magnitudes(const VTBignum& a, const VTBignum& b, VTBignum& x, VTBignum& y) const
+    {
+        if (!single_limbs())
+        {
+            reduce(a, b, x, y);
+            return;
+        }
+
+        int n = std::max(a.limbs(), b.limbs());
+        x._chunks.resize(n + 1);
+        y._chunks.resize(n + 1);
+        mul_sub_1(&x._chunks[0], a._chunks.begin(), a.limbs(), m[1][1].limb(0), b._chunks.begin(), b.limbs(), m[0][1].limb(0), n);
+        mul_sub_1(&y._chunks[0], b._chunks.begin(), b.limbs(), m[0][0].limb(0), a._chunks.begin(), a.limbs(), m[1][0].limb(0), n);
+        x._sign = 0;
+        y._sign = 0;
+        x.normilize();
+        y.normilize();
+    }
+};
+
+VTBignum VTBignum::gcd(const VTBignum& a, const VTBignum& b)
+{
+    return gcd_reduce(a, b, 0);
+}
+
+VTBignum VTBignum::xgcd(const VTBignum& a, const VTBignum& b, VTBignum& s, VTBignum& t)
+{
+    VTBignum cofactor;
+    VTBignum g = gcd_reduce(a, b, &cofactor);
+
+    VTBignum s_result, t_result;
+    if (b.limbs() == 0)
+    {
+        s_result = fromInt(a.limbs() == 0 ? 0 : (a._sign == 1 ? -1 : 1));
+    }
+    else
+    {
+        // s is unique modulo |b| / g, the one nearest to zero is taken
+        VTBignum period = b / g;
+        period._sign = 0;
+        s_result = cofactor % period;
+        if (s_result._sign == 1)
+            s_result += period;
+        if ((s_result << 1) > period)
+            s_result -= period;
+        if (a._sign == 1)
+            s_result = -s_result;
+        t_result = (g - s_result * a) / b;
+    }
+
+    // s and t may be a or b
+    swap(s, s_result);
+    swap(t, t_result);
+    return g;
+}
+
+VTBignum VTBignum::modinv(const VTBignum& a, const VTBignum& mod)
+{
+    if (mod.limbs() == 0)
+        throw std::runtime_error("Division by zero");
+
+    VTBignum m(mod);
+    m._sign = 0;
+    if (m == fromInt(1))
+        return VTBignum();
+
+    VTBignum residue = a % m;
+    if (residue._sign == 1)
+        residue += m;
+
+    VTBignum cofactor;
+    if (gcd_reduce(residue, m, &cofactor) != fromInt(1))
+        throw std::runtime_error("Not invertible");
+
+    cofactor %= m;
+    if (cofactor._sign == 1)
+        cofactor += m;
+    return cofactor;
+}
+
+VTBignum VTBignum::gcd_reduce(VTBignum a, VTBignum b, VTBignum* cofactor)
+{
+    VT_STAT_OPERATION(Stat_gcd, a.limbs() + b.limbs());
+    a._sign = 0;
+    b._sign = 0;
+
+    // a == s[0] * |a0| + t * |b0| and b == s[1] * |a0| + t' * |b0| for the original a0, b0
+    VTBignum s[2];
+    s[0] = fromInt(1);
+
+    VTBignum x, y;
+    GcdMatrix m;
+    while (a.limbs() > 0 && b.limbs() > 0)
+    {
+        if (cofactor == 0 && std::min(a.limbs(), b.limbs()) == 1)
+        {
+            // remainder by the single limb is a single limb too
+            const VTBignum& single = (a.limbs() == 1 ? a : b);
+            const VTBignum& other = (a.limbs() == 1 ? b : a);
+            limb_t g = gcd_1(single._chunks[0], (other % single).limb(0));
+            return fromLimbs(&g, 1);
+        }
+
+        if (a.limbs() == 1 && b.limbs() == 1)
+        {
+            limb_t s_limb, t_limb;
+            bool s_negative;
+            limb_t g = xgcd_1(a._chunks[0], b._chunks[0], s_limb, t_limb, s_negative);
+            *cofactor = fromLimbs(&s_limb, 1, s_negative) * s[0] + fromLimbs(&t_limb, 1, !s_negative) * s[1];
+            return fromLimbs(&g, 1);
+        }
+
+        if (std::min(a.limbs(), b.limbs()) < thresholds.gcd_dc || !hgcd(a, b, m))
+        {
+            gcd_step(a, b, m);
+            m.reduce_magnitudes(a, b, x, y);
+            swap(a, x);
+            swap(b, y);
+        }
+
+        if (cofactor != 0)
+        {
+            m.reduce(s[0], s[1], x, y);
+            swap(s[0], x);
+            swap(s[1], y);
+        }
+    }
+
+    if (cofactor != 0)
+        swap(*cofactor, a.limbs() > 0 ? s[0] : s[1]);
+    return ( a.limbs() > 0 ? a : b );
+}
+
+/*
+    Lehmer step: Euclid's algorithm runs on the leading bits A, B of a and b
+    (two limbs of the larger one and the same bits of the other one) while its
+    steps are steps of a and b as well. With a = A 2^k + a', b = B 2^k + b' and
+    the reduced pair (alpha; beta) = M^-1 (A; B), the pair M^-1 (a; b) is
+    (alpha 2^k + m11 a' - m01 b'; beta 2^k + m00 b' - m10 a'), which is not
+    negative while alpha >= m01 and beta >= m10. Entries stay single limbs.
+    If not even the first step is certain, like when b is much shorter than a,
+    the step divides the larger number by the smaller one.
+*/
+void VTBignum::gcd_step(const VTBignum& a, const VTBignum& b, GcdMatrix& step)
+{
+    VT_STAT_TIER(Stat_gcd_lehmer);
+    assert(a.limbs() > 0 && b.limbs() > 0);
+
+    int shift = std::max(0, std::max(a.bit_length(), b.bit_length()) - HAT_LIMBS * LIMB_BITS);
+    hat_t alpha = leading_bits(a, shift);
+    hat_t beta = leading_bits(b, shift);
+
+    const hat_t max = LIMB_MAX;
+    hat_t m00 = 1, m01 = 0, m10 = 0, m11 = 1;
+    for (;;)
+    {
+        if (alpha >= beta)
+        {
+            if (beta == 0)
+                break;
+            hat_t q = (alpha - beta < beta ? 1 : alpha / beta);
+            if (q > (max - m01) / m00 || (m10 != 0 && q > (max - m11) / m10))
+                break;
+            hat_t r = alpha - q * beta;
+            if (r < m01 + q * m00)
+                break;
+            alpha = r;
+            m01 += q * m00;
+            m11 += q * m10;
+        }
+        else
+        {
+            if (alpha == 0)
+                break;
+            hat_t q = (beta - alpha < alpha ? 1 : beta / alpha);
+            if (q > (max - m10) / m11 || (m01 != 0 && q > (max - m00) / m01))
+                break;
+            hat_t r = beta - q * alpha;
+            if (r < m10 + q * m11)
+                break;
+            beta = r;
+            m10 += q * m11;
+            m00 += q * m01;
+        }
+    }
+
+    step = GcdMatrix();
+    if (m01 == 0 && m10 == 0)
+    {
+        if (a >= b)
+            step.m[0][1] = a / b;
+        else
+            step.m[1][0] = b / a;
+        return;
+    }
+
+    limb_t entries[2][2] = { { static_cast<limb_t>(m00), static_cast<limb_t>(m01) },
+                             { static_cast<limb_t>(m10), static_cast<limb_t>(m11) } };
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+            step.m[i][j] = fromLimbs(&entries[i][j], 1);
+    }
+}
+
+/*
+    Half-GCD: a, b are reduced by m as long as the product of the reduced pair
+    (x; y) stays above the larger of a and b, which leaves about half of their
+    bits. Such m is a valid Lehmer matrix (see gcd_step) for any numbers that a
+    and b are the leading bits of, as a == m00 x + m01 y >= m01 y and a <= x y
+    give m01 <= x, and m10 <= y the same way.
+    Long numbers of p limbs are reduced by the half-GCD of their part above
+    p / 2 limbs to about 3p / 4 limbs, and then by the half-GCD of their part
+    above p / 4 limbs to about p / 2 limbs. Return false if nothing was reduced.
+*/
+bool VTBignum::hgcd(VTBignum& a, VTBignum& b, GcdMatrix& m)
+{
+    VT_STAT_TIER(Stat_gcd_half);
+    m = GcdMatrix();
+
+    // x y > max(a, b) holds when bit lengths of x and y add up to this at least
+    int bits = std::max(a.bit_length(), b.bit_length()) + 2;
+    int p = std::max(a.limbs(), b.limbs());
+    if (p < thresholds.gcd_dc)
+        return hgcd_lehmer(a, b, m, bits, -1);
+
+    if (!hgcd_half(a, b, m, p / 2, bits))
+        return hgcd_lehmer(a, b, m, bits, 1);
+
+    int k = p - std::max(a.limbs(), b.limbs());
+    if (k > 0)
+        hgcd_half(a, b, m, k, bits);
+    return true;
+}
+
+// reduce a, b by the half-GCD of their part above k limbs, unless the reduced pair gets too small
+bool VTBignum::hgcd_half(VTBignum& a, VTBignum& b, GcdMatrix& m, int k, int bits)
+{
+    if (a.limbs() <= k || b.limbs() <= k)
+        return false;
+
+    VTBignum x = fromLimbs(a._chunks.begin() + k, a.limbs() - k);
+    VTBignum y = fromLimbs(b._chunks.begin() + k, b.limbs() - k);
+    GcdMatrix step;
+    if (!hgcd(x, y, step))
+        return false;
+
+    // M^-1 (x 2^k + a_low; y 2^k + b_low) == (x' 2^k; y' 2^k) + M^-1 (a_low; b_low), low parts may go negative
+    VTBignum a_low = fromLimbs(a._chunks.begin(), k);
+    VTBignum b_low = fromLimbs(b._chunks.begin(), k);
+    VTBignum x_low, y_low;
+    step.reduce(a_low, b_low, x_low, y_low);
+    x.shift_left(k * LIMB_BITS);
+    y.shift_left(k * LIMB_BITS);
+    x += x_low;
+    y += y_low;
+    assert(x._sign == 0 && y._sign == 0);
+
+    if (x.bit_length() + y.bit_length() < bits)
+        return false;
+    swap(a, x);
+    swap(b, y);
+    m.multiply(step);
+    return true;
+}
+
+// at most steps (all if negative) Lehmer steps of a, b, unless the reduced pair gets too small
+bool VTBignum::hgcd_lehmer(VTBignum& a, VTBignum& b, GcdMatrix& m, int bits, int steps)
+{
+    bool reduced = false;
+    VTBignum x, y;
+    GcdMatrix step;
+    for (; steps != 0 && a.limbs() > 0 && b.limbs() > 0; --steps)
+    {
+        gcd_step(a, b, step);
+        step.reduce_magnitudes(a, b, x, y);
+        if (x.bit_length() + y.bit_length() < bits)
+            break;
+        swap(a, x);
+        swap(b, y);
+        m.multiply(step);
+        reduced = true;
+    }
+    return reduced;
+}
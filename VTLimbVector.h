@@ -0,0 +1,204 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+
+#include "VTLimbs.h"
+#include "VTStats.h"
+
+namespace VTLimbs
+{
+    /*
+        Growable array of limbs with the subset of std::vector interface
+        VTBignum needs. The first Inline limbs live inside the object,
+        so that small numbers never touch the heap; longer arrays come from
+        Allocator. Its instances must be interchangeable, like std::allocator,
+        because heap blocks move between vectors on swap.
+        Limbs past size() are not initialised, unlike with std::vector.
+    */
+    template <int Inline, class Allocator = std::allocator<limb_t> >
+    class LimbVector : private Allocator
+    {
+    public:
+        typedef limb_t value_type;
+        typedef limb_t* iterator;
+        typedef const limb_t* const_iterator;
+
+        LimbVector(): _data(_inline), _size(0), _capacity(Inline)
+        {}
+
+        LimbVector(const LimbVector& other): Allocator(other), _data(_inline), _size(0), _capacity(Inline)
+        {
+            assign(other.begin(), other.end());
+        }
+
+        LimbVector& operator=(const LimbVector& other)
+        {
+            if (this != &other)
+                assign(other.begin(), other.end());
+            return *this;
+        }
+
+#if defined(VT_HAS_RVALUE_REFERENCES)
+        // heap block is taken over, inline limbs are copied; other is left empty
+        LimbVector(LimbVector&& other): _data(_inline), _size(0), _capacity(Inline)
+        {
+            swap(other);
+        }
+
+        LimbVector& operator=(LimbVector&& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                swap(other);
+            }
+            return *this;
+        }
+#endif
+
+        ~LimbVector()
+        {
+            if (!is_inline())
+                this->deallocate(_data, _capacity);
+        }
+
+        inline size_t size() const { return _size; }
+        inline size_t capacity() const { return _capacity; }
+        inline bool empty() const { return _size == 0; }
+        inline bool is_inline() const { return _data == _inline; }
+
+        inline limb_t& operator[](size_t i) { return _data[i]; }
+        inline const limb_t& operator[](size_t i) const { return _data[i]; }
+        inline limb_t& back() { return _data[_size - 1]; }
+        inline const limb_t& back() const { return _data[_size - 1]; }
+
+        inline iterator begin() { return _data; }
+        inline iterator end() { return _data + _size; }
+        inline const_iterator begin() const { return _data; }
+        inline const_iterator end() const { return _data + _size; }
+
+        void reserve(size_t n)
+        {
+            if (n > _capacity)
+                reallocate(n);
+        }
+
+        void resize(size_t n, limb_t value = 0)
+        {
+            reserve(n);
+            if (n > _size)
+                std::fill(_data + _size, _data + n, value);
+            _size = n;
+        }
+
+        void assign(size_t n, limb_t value)
+        {
+            reserve(n);
+            std::fill(_data, _data + n, value);
+            _size = n;
+        }
+
+        void assign(const limb_t* first, const limb_t* last)
+        {
+            size_t n = last - first;
+            reserve(n);
+            memmove(_data, first, n * sizeof(limb_t));
+            _size = n;
+        }
+
+        inline void clear() { _size = 0; }
+        inline void pop_back() { --_size; }
+
+        inline void push_back(limb_t value)
+        {
+            if (_size == _capacity)
+                reallocate(2 * _capacity);
+            _data[_size++] = value;
+        }
+
+        void swap(LimbVector& other)
+        {
+            if (!is_inline() && !other.is_inline())
+            {
+                std::swap(_data, other._data);
+                std::swap(_capacity, other._capacity);
+            }
+            else if (is_inline() && other.is_inline())
+            {
+                // only limbs below the sizes, the rest were never written
+                limb_t temp[Inline];
+                memcpy(temp, _inline, _size * sizeof(limb_t));
+                memcpy(_inline, other._inline, other._size * sizeof(limb_t));
+                memcpy(other._inline, temp, _size * sizeof(limb_t));
+            }
+            else
+            {
+                // the inline one takes over the heap block, the other one gets the inline limbs
+                LimbVector& small = (is_inline() ? *this : other);
+                LimbVector& large = (is_inline() ? other : *this);
+                memcpy(large._inline, small._inline, small._size * sizeof(limb_t));
+                small._data = large._data;
+                small._capacity = large._capacity;
+                large._data = large._inline;
+                large._capacity = Inline;
+            }
+            std::swap(_size, other._size);
+        }
+
+        friend bool operator==(const LimbVector& a, const LimbVector& b)
+        {
+            return a._size == b._size && std::equal(a.begin(), a.end(), b.begin());
+        }
+
+    private:
+        // push_back doubles the capacity, so an empty inline buffer would never grow
+        typedef char inline_limbs_must_be_positive[Inline >= 1 ? 1 : -1];
+
+        void reallocate(size_t n)
+        {
+            limb_t* data = this->allocate(n);
+            VT_STAT_ALLOCATION(n * sizeof(limb_t));
+            memcpy(data, _data, _size * sizeof(limb_t));
+            if (!is_inline())
+                this->deallocate(_data, _capacity);
+            _data = data;
+            _capacity = n;
+        }
+
+        limb_t* _data;      // points to _inline or to a heap block
+        size_t _size;
+        size_t _capacity;
+        limb_t _inline[Inline];
+    };
+}
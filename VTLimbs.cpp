@@ -0,0 +1,639 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTLimbs.h"
+#include "VTStats.h"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+namespace VTLimbs
+{
+
+Thresholds thresholds =
+{
+    32,     // mul_karatsuba
+    128,    // mul_toom3
+    8000,   // mul_ntt
+    48,     // sqr_karatsuba
+    160,    // sqr_toom3
+    2000,   // div_newton
+    30,     // str_dc
+    1500,   // mul_parallel
+    1000    // gcd_dc
+};
+
+limb_t add_n(limb_t* r, const limb_t* a, const limb_t* b, int n)
+{
+    limb_t carry = 0;
+    for (int i = 0; i < n; ++i)
+        r[i] = add_carry(a[i], b[i], carry);
+    return carry;
+}
+
+limb_t add_1(limb_t* r, const limb_t* a, int n, limb_t b)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        r[i] = a[i] + b;
+        b = (r[i] < b);
+        if (b == 0)
+        {
+            if (r != a)
+                memcpy(r + i + 1, a + i + 1, (n - i - 1) * sizeof(limb_t));
+            return 0;
+        }
+    }
+    return b;
+}
+
+limb_t add(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn)
+{
+    assert(an >= bn);
+    limb_t carry = add_n(r, a, b, bn);
+    return add_1(r + bn, a + bn, an - bn, carry);
+}
+
+limb_t sub_n(limb_t* r, const limb_t* a, const limb_t* b, int n)
+{
+    limb_t borrow = 0;
+    for (int i = 0; i < n; ++i)
+        r[i] = sub_borrow(a[i], b[i], borrow);
+    return borrow;
+}
+
+limb_t sub_1(limb_t* r, const limb_t* a, int n, limb_t b)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        limb_t x = a[i];
+        r[i] = x - b;
+        b = (x < b);
+        if (b == 0)
+        {
+            if (r != a)
+                memcpy(r + i + 1, a + i + 1, (n - i - 1) * sizeof(limb_t));
+            return 0;
+        }
+    }
+    return b;
+}
+
+limb_t sub(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn)
+{
+    assert(an >= bn);
+    limb_t borrow = sub_n(r, a, b, bn);
+    return sub_1(r + bn, a + bn, an - bn, borrow);
+}
+
+int cmp(const limb_t* a, const limb_t* b, int n)
+{
+    for (int i = n - 1; i >= 0; --i)
+    {
+        if (a[i] != b[i])
+            return ( a[i] > b[i] ? 1 : -1 );
+    }
+    return 0;
+}
+
+int normalized_size(const limb_t* a, int n)
+{
+    while (n > 0 && a[n - 1] == 0)
+        --n;
+    return n;
+}
+
+limb_t lshift(limb_t* r, const limb_t* a, int n, int count)
+{
+    assert(count > 0 && count < LIMB_BITS);
+    limb_t out = a[n - 1] >> (LIMB_BITS - count);
+    for (int i = n - 1; i > 0; --i)
+        r[i] = (a[i] << count) | (a[i - 1] >> (LIMB_BITS - count));
+    r[0] = a[0] << count;
+    return out;
+}
+
+limb_t rshift(limb_t* r, const limb_t* a, int n, int count)
+{
+    assert(count > 0 && count < LIMB_BITS);
+    limb_t out = a[0] << (LIMB_BITS - count);
+    for (int i = 0; i < n - 1; ++i)
+        r[i] = (a[i] >> count) | (a[i + 1] << (LIMB_BITS - count));
+    r[n - 1] = a[n - 1] >> count;
+    return out;
+}
+
+limb_t mul_1(limb_t* r, const limb_t* a, int n, limb_t b)
+{
+    limb_t carry = 0;
+    for (int i = 0; i < n; ++i)
+        r[i] = mul_add(a[i], b, carry, 0, carry);
+    return carry;
+}
+
+limb_t addmul_1(limb_t* r, const limb_t* a, int n, limb_t b)
+{
+    limb_t carry = 0;
+    for (int i = 0; i < n; ++i)
+        r[i] = mul_add(a[i], b, carry, r[i], carry);
+    return carry;
+}
+
+limb_t submul_1(limb_t* r, const limb_t* a, int n, limb_t b)
+{
+    limb_t borrow = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        limb_t hi;
+        limb_t lo = mul_add(a[i], b, borrow, 0, hi);
+        limb_t x = r[i];
+        r[i] = x - lo;
+        borrow = hi + (x < lo);
+    }
+    return borrow;
+}
+
+limb_t divrem_1(limb_t* q, const limb_t* a, int n, limb_t d)
+{
+    assert(d != 0);
+    limb_t remainder = 0;
+    for (int i = n - 1; i >= 0; --i)
+        q[i] = div_wide(remainder, a[i], d, remainder);
+    return remainder;
+}
+
+/*
+    Knuth's algorithm D (TAOCP vol. 2, 4.3.1): divisor is shifted so that
+    its top bit is set, then every quotient limb is estimated from the top
+    two limbs of the remainder and corrected at most twice.
+*/
+void divrem(limb_t* q, limb_t* r, const limb_t* a, int an, const limb_t* d, int dn)
+{
+    assert(dn >= 2 && an >= dn && d[dn - 1] != 0);
+    VT_STAT_TIER(Stat_div_knuth);
+
+    int shift = count_leading_zeros(d[dn - 1]);
+
+    // short operands are normalised on the stack
+    limb_t local[16];
+    ScratchFrame scratch;
+    limb_t* u = (an + 1 + dn > 16 ? scratch.alloc(an + 1 + dn) : local);
+    limb_t* v = u + an + 1;
+    if (shift != 0)
+    {
+        lshift(v, d, dn, shift);
+        u[an] = lshift(u, a, an, shift);
+    }
+    else
+    {
+        memcpy(v, d, dn * sizeof(limb_t));
+        memcpy(u, a, an * sizeof(limb_t));
+        u[an] = 0;
+    }
+
+    const limb_t v_top = v[dn - 1];
+    const limb_t v_next = v[dn - 2];
+
+    for (int j = an - dn; j >= 0; --j)
+    {
+        limb_t u_top = u[j + dn];
+        limb_t qhat, rhat;
+        bool rhat_overflow = false;
+
+        if (u_top >= v_top)
+        {
+            qhat = LIMB_MAX;
+            rhat = u[j + dn - 1] + v_top;
+            rhat_overflow = (rhat < v_top);
+        }
+        else
+        {
+            qhat = div_wide(u_top, u[j + dn - 1], v_top, rhat);
+        }
+
+        // qhat is at most 2 too big, check it against the next limb
+        while (!rhat_overflow)
+        {
+            limb_t hi;
+            limb_t lo = mul_wide(qhat, v_next, hi);
+            if (hi < rhat || (hi == rhat && lo <= u[j + dn - 2]))
+                break;
+
+            --qhat;
+            rhat += v_top;
+            rhat_overflow = (rhat < v_top);
+        }
+
+        limb_t borrow = submul_1(u + j, v, dn, qhat);
+        u[j + dn] = u_top - borrow;
+
+        // rare case: qhat was still one too big, add divisor back
+        if (u_top < borrow)
+        {
+            --qhat;
+            u[j + dn] += add_n(u + j, u + j, v, dn);
+        }
+
+        q[j] = qhat;
+    }
+
+    if (shift != 0)
+        rshift(r, u, dn, shift);
+    else
+        memcpy(r, u, dn * sizeof(limb_t));
+}
+
+void redc(limb_t* r, limb_t* t, const limb_t* m, int n, limb_t m_inv)
+{
+    // every row clears one low limb of t by adding a multiple of m;
+    // overflow of the row's top limb goes into the next row
+    limb_t top_carry = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        limb_t u = t[i] * m_inv;
+        limb_t carry = addmul_1(t + i, m, n, u);
+
+        limb_t x = t[i + n] + carry;
+        limb_t overflow = (x < carry);
+        x += top_carry;
+        overflow += (x < top_carry);
+        t[i + n] = x;
+        top_carry = overflow;
+    }
+
+    // result is below 2m
+    if (top_carry != 0 || cmp(t + n, m, n) >= 0)
+        sub_n(r, t + n, m, n);
+    else
+        memcpy(r, t + n, n * sizeof(limb_t));
+}
+
+void mul_basecase(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn)
+{
+    assert(an >= bn && bn >= 1);
+    VT_STAT_TIER(Stat_mul_basecase);
+
+    // first row initialises r, the rest accumulate into it
+    r[an] = mul_1(r, a, an, b[0]);
+    for (int i = 1; i < bn; ++i)
+        r[an + i] = addmul_1(r + i, a, an, b[i]);
+}
+
+void sqr_basecase(limb_t* r, const limb_t* a, int n)
+{
+    assert(n >= 1);
+    VT_STAT_TIER(Stat_sqr_basecase);
+
+    if (n == 1)
+    {
+        r[0] = mul_wide(a[0], a[0], r[1]);
+        return;
+    }
+
+    // products a[i] * a[j] for i < j, every one of them appears twice in the square
+    r[0] = 0;
+    r[n] = mul_1(r + 1, a + 1, n - 1, a[0]);
+    for (int i = 1; i < n - 1; ++i)
+        r[n + i] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+    r[2 * n - 1] = lshift(r + 1, r + 1, 2 * n - 2, 1);
+
+    // add the diagonal a[i]^2
+    limb_t carry = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        limb_t hi;
+        limb_t lo = mul_wide(a[i], a[i], hi);
+        r[2 * i] = add_carry(r[2 * i], lo, carry);
+        r[2 * i + 1] = add_carry(r[2 * i + 1], hi, carry);
+    }
+    assert(carry == 0);
+}
+
+namespace
+{
+    void mul_n(limb_t* r, const limb_t* a, const limb_t* b, int n);
+    void sqr_n(limb_t* r, const limb_t* a, int n);
+
+    // balanced product, or square of a if square is set (b is ignored then)
+    inline void product_n(limb_t* r, const limb_t* a, const limb_t* b, int n, bool square)
+    {
+        if (square)
+            sqr_n(r, a, n);
+        else
+            mul_n(r, a, b, n);
+    }
+
+    // add a into r (both starting at the same position), propagating carry up to rn limbs
+    void add_into(limb_t* r, int rn, const limb_t* a, int an)
+    {
+        an = normalized_size(a, an);
+        assert(an <= rn);
+        limb_t carry = add_n(r, r, a, an);
+        carry = add_1(r + an, r + an, rn - an, carry);
+        assert(carry == 0);
+    }
+
+    // pointwise products of Karatsuba and Toom-3, independent of each other
+    struct Products
+    {
+        enum { MAX = 5 };
+
+        Products(bool square_products): count(0), square(square_products)
+        {}
+
+        void add(limb_t* r, const limb_t* a, const limb_t* b, int n)
+        {
+            results[count] = r;
+            lefts[count] = a;
+            rights[count] = b;
+            sizes[count] = n;
+            ++count;
+        }
+
+        void operator()(int i)
+        {
+            product_n(results[i], lefts[i], rights[i], sizes[i], square);
+        }
+
+        // on all threads for long operands
+        void run(int n)
+        {
+            if (n >= thresholds.mul_parallel && threads() > 1)
+            {
+                parallel_for(count, *this);
+            }
+            else
+            {
+                for (int i = 0; i < count; ++i)
+                    (*this)(i);
+            }
+        }
+
+        limb_t* results[MAX];
+        const limb_t* lefts[MAX];
+        const limb_t* rights[MAX];
+        int sizes[MAX];
+        int count;
+        bool square;
+    };
+
+    /*
+        Karatsuba: a = a1 * x + a0, b = b1 * x + b0, x = B^k
+
+        a * b = z2 * x^2 + z1 * x + z0, where
+        z0 = a0 * b0, z2 = a1 * b1, z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+    */
+    void mul_karatsuba(limb_t* r, const limb_t* a, const limb_t* b, int n, bool square)
+    {
+        VT_STAT_TIER(square ? Stat_sqr_karatsuba : Stat_mul_karatsuba);
+        int k = (n + 1) / 2;
+        int h = n - k;
+
+        ScratchFrame scratch;
+        limb_t* sa = scratch.alloc(4 * (k + 1));
+        limb_t* sb = sa + (k + 1);
+        limb_t* z1 = sb + (k + 1);
+
+        sa[k] = add(sa, a, k, a + k, h);
+        if (!square)
+            sb[k] = add(sb, b, k, b + k, h);
+
+        Products products(square);
+        products.add(r, a, b, k);
+        products.add(r + 2 * k, a + k, b + k, h);
+        products.add(z1, sa, sb, k + 1);
+        products.run(n);
+
+        limb_t borrow = sub(z1, z1, 2 * (k + 1), r, 2 * k);
+        borrow += sub(z1, z1, 2 * (k + 1), r + 2 * k, 2 * h);
+        assert(borrow == 0);
+
+        add_into(r + k, 2 * n - k, z1, 2 * (k + 1));
+    }
+
+    /*
+        Toom-3: split operands into three parts of k limbs, evaluate at
+        0, 1, -1, 2 and infinity, multiply pointwise and interpolate back
+        (sequence by Bodrato, only a(-1) * b(-1) can be negative).
+        Squaring evaluates a only and squares pointwise.
+    */
+    void mul_toom3(limb_t* r, const limb_t* a, const limb_t* b, int n, bool square)
+    {
+        VT_STAT_TIER(square ? Stat_sqr_toom3 : Stat_mul_toom3);
+        int k = (n + 2) / 3;
+        int l2 = n - 2 * k;        // length of the top parts
+        int m = k + 1;              // length of evaluated parts
+        int len = 2 * m;            // length of pointwise products
+
+        const limb_t* a0 = a;
+        const limb_t* a1 = a + k;
+        const limb_t* a2 = a + 2 * k;
+        const limb_t* b0 = b;
+        const limb_t* b1 = b + k;
+        const limb_t* b2 = b + 2 * k;
+
+        ScratchFrame scratch;
+        limb_t* ea = scratch.alloc(8 * m + 3 * len);   // a(1)
+        limb_t* eb = ea + m;            // b(1)
+        limb_t* ema = eb + m;           // |a(-1)|
+        limb_t* emb = ema + m;          // |b(-1)|
+        limb_t* e2a = emb + m;          // a(2)
+        limb_t* e2b = e2a + m;          // b(2)
+        limb_t* pa = e2b + m;           // a0 + a2
+        limb_t* pb = pa + m;            // b0 + b2
+        limb_t* v1 = pb + m;
+        limb_t* vm1 = v1 + len;
+        limb_t* v2 = vm1 + len;
+
+        // a0 + a2, a(1) = a0 + a1 + a2, |a(-1)| = |a0 - a1 + a2|, a(2) = a0 + 2 * (a1 + 2 * a2)
+        int vm1_negative = 0;
+        const limb_t* parts[2][3] = { {a0, a1, a2}, {b0, b1, b2} };
+        limb_t* sums[2] = {pa, pb};
+        limb_t* ones[2] = {ea, eb};
+        limb_t* minus_ones[2] = {ema, emb};
+        limb_t* twos[2] = {e2a, e2b};
+        int operands = (square ? 1 : 2);
+        for (int j = 0; j < operands; ++j)
+        {
+            limb_t* p = sums[j];
+            p[k] = add(p, parts[j][0], k, parts[j][2], l2);
+            ones[j][k] = p[k] + add_n(ones[j], p, parts[j][1], k);
+
+            if (p[k] == 0 && cmp(p, parts[j][1], k) < 0)
+            {
+                sub_n(minus_ones[j], parts[j][1], p, k);
+                minus_ones[j][k] = 0;
+                vm1_negative ^= 1;
+            }
+            else
+            {
+                minus_ones[j][k] = p[k] - sub_n(minus_ones[j], p, parts[j][1], k);
+            }
+
+            // a(2) fits into k + 1 limbs
+            limb_t* e = twos[j];
+            memset(e, 0, m * sizeof(limb_t));
+            memcpy(e, parts[j][2], l2 * sizeof(limb_t));
+            lshift(e, e, m, 1);
+            add(e, e, m, parts[j][1], k);
+            lshift(e, e, m, 1);
+            add(e, e, m, parts[j][0], k);
+        }
+
+        if (square)
+            vm1_negative = 0;
+
+        // v0 and vinf go straight into their final places
+        Products products(square);
+        products.add(v1, ea, eb, m);
+        products.add(vm1, ema, emb, m);
+        products.add(v2, e2a, e2b, m);
+        products.add(r, a0, b0, k);
+        products.add(r + 4 * k, a2, b2, l2);
+        products.run(n);
+
+        memset(r + 2 * k, 0, 2 * k * sizeof(limb_t));
+        limb_t* v0 = r;
+        limb_t* vinf = r + 4 * k;
+
+        // v2 = (v2 - vm1) / 3; vm1 = (v1 - vm1) / 2
+        if (vm1_negative)
+        {
+            add_n(v2, v2, vm1, len);
+            add_n(vm1, v1, vm1, len);
+        }
+        else
+        {
+            sub_n(v2, v2, vm1, len);
+            sub_n(vm1, v1, vm1, len);
+        }
+        divrem_1(v2, v2, len, 3);
+        rshift(vm1, vm1, len, 1);
+
+        // v1 = v1 - v0; v2 = (v2 - v1) / 2
+        sub(v1, v1, len, v0, 2 * k);
+        sub_n(v2, v2, v1, len);
+        rshift(v2, v2, len, 1);
+
+        // v1 = v1 - vm1 - vinf; v2 = v2 - 2 * vinf; vm1 = vm1 - v2
+        sub_n(v1, v1, vm1, len);
+        sub(v1, v1, len, vinf, 2 * l2);
+        sub(v2, v2, len, vinf, 2 * l2);
+        sub(v2, v2, len, vinf, 2 * l2);
+        sub_n(vm1, vm1, v2, len);
+
+        // coefficients 1, 2 and 3 overlap with each other and with v0/vinf
+        add_into(r + k, 2 * n - k, vm1, len);
+        add_into(r + 2 * k, 2 * n - 2 * k, v1, len);
+        add_into(r + 3 * k, 2 * n - 3 * k, v2, len);
+    }
+
+    // balanced multiplication, r gets 2 * n limbs
+    void mul_n(limb_t* r, const limb_t* a, const limb_t* b, int n)
+    {
+        // smaller sizes would recurse on operands that are not shorter
+        if (n < thresholds.mul_karatsuba || n < 4)
+            mul_basecase(r, a, n, b, n);
+        else if (n < thresholds.mul_toom3 || n < 5)
+            mul_karatsuba(r, a, b, n, false);
+        else if (n < thresholds.mul_ntt)
+            mul_toom3(r, a, b, n, false);
+        else
+            mul_ntt(r, a, n, b, n);
+    }
+
+    // square, r gets 2 * n limbs
+    void sqr_n(limb_t* r, const limb_t* a, int n)
+    {
+        if (n < thresholds.sqr_karatsuba || n < 4)
+            sqr_basecase(r, a, n);
+        else if (n < thresholds.sqr_toom3 || n < 5)
+            mul_karatsuba(r, a, a, n, true);
+        else if (n < thresholds.mul_ntt)
+            mul_toom3(r, a, a, n, true);
+        else
+            mul_ntt(r, a, n, a, n);
+    }
+}
+
+void sqr(limb_t* r, const limb_t* a, int n)
+{
+    assert(n >= 1);
+    sqr_n(r, a, n);
+}
+
+void mul(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn)
+{
+    assert(an >= bn && bn >= 1);
+
+    if (a == b && an == bn)
+    {
+        sqr_n(r, a, an);
+        return;
+    }
+
+    if (bn < thresholds.mul_karatsuba)
+    {
+        mul_basecase(r, a, an, b, bn);
+        return;
+    }
+
+    // transform length follows an + bn, so NTT handles unbalanced operands as is
+    if (bn >= thresholds.mul_ntt)
+    {
+        mul_ntt(r, a, an, b, bn);
+        return;
+    }
+
+    if (an == bn)
+    {
+        mul_n(r, a, b, bn);
+        return;
+    }
+
+    // unbalanced operands: cut a into slices of bn limbs, so that
+    // every partial product is balanced (except possibly the last one)
+    mul_n(r, a, b, bn);
+
+    ScratchFrame scratch;
+    limb_t* partial = scratch.alloc(2 * bn);
+    for (int offset = bn; offset < an; offset += bn)
+    {
+        int len = std::min(bn, an - offset);
+        mul(partial, b, bn, a + offset, len);
+
+        // r[offset..offset + bn) holds the high half of the previous slice
+        limb_t carry = add_n(r + offset, r + offset, partial, bn);
+        memcpy(r + offset + bn, partial + bn, len * sizeof(limb_t));
+        carry = add_1(r + offset + bn, r + offset + bn, len, carry);
+        assert(carry == 0);
+    }
+}
+
+}
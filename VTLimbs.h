@@ -0,0 +1,377 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#pragma once
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#include <stddef.h>
+
+// rvalue references: C++11 compilers and Visual Studio 2010 or later
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+#define VT_HAS_RVALUE_REFERENCES 1
+#endif
+
+// thread_local: C++11 compilers and Visual Studio 2015 or later
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define VT_HAS_THREAD_LOCAL 1
+#endif
+
+// worker threads for multiplication: where thread_local is there, so are std::thread and std::mutex
+#if defined(VT_HAS_THREAD_LOCAL)
+#define VT_HAS_THREADS 1
+#endif
+
+// constexpr functions with loops and local variables: C++14 compilers and Visual Studio 2017 or later;
+// VT_CONSTEXPR marks functions that are constexpr there and plain inline elsewhere
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L && _MSC_VER >= 1910)
+#define VT_HAS_CONSTEXPR 1
+#define VT_CONSTEXPR constexpr
+#else
+#define VT_CONSTEXPR inline
+#endif
+
+/*
+    Machine word primitives used by VTBignum.
+
+    Numbers are stored as arrays of 64-bit words (limbs), least significant first.
+    Double-width intermediates use unsigned __int128 when the compiler has it,
+    MSVC intrinsics on x64 and a portable 32-bit halves fallback otherwise.
+*/
+namespace VTLimbs
+{
+    typedef unsigned long long limb_t;
+
+    const int LIMB_BITS = 64;
+    const int LIMB_BYTES = 8;
+    const limb_t LIMB_MAX = ~static_cast<limb_t>(0);
+
+    // true if limbs are stored least significant byte first
+    inline bool little_endian()
+    {
+        const limb_t one = 1;
+        return *reinterpret_cast<const unsigned char*>(&one) == 1;
+    }
+
+#if defined(__SIZEOF_INT128__)
+    typedef unsigned __int128 dlimb_t;
+#endif
+
+    // return low word of a * b, store high word to hi; 32-bit halves,
+    // for compilers without double-width type and for constant expressions
+    VT_CONSTEXPR limb_t mul_wide_halves(limb_t a, limb_t b, limb_t& hi)
+    {
+        limb_t a_lo = a & 0xffffffffULL, a_hi = a >> 32;
+        limb_t b_lo = b & 0xffffffffULL, b_hi = b >> 32;
+
+        limb_t lo_lo = a_lo * b_lo;
+        limb_t hi_lo = a_hi * b_lo;
+        limb_t lo_hi = a_lo * b_hi;
+        limb_t hi_hi = a_hi * b_hi;
+
+        limb_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffffULL) + lo_hi;
+        hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+        return (cross << 32) | (lo_lo & 0xffffffffULL);
+    }
+
+    // return low word of a * b, store high word to hi
+    inline limb_t mul_wide(limb_t a, limb_t b, limb_t& hi)
+    {
+#if defined(__SIZEOF_INT128__)
+        dlimb_t product = static_cast<dlimb_t>(a) * b;
+        hi = static_cast<limb_t>(product >> LIMB_BITS);
+        return static_cast<limb_t>(product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return _umul128(a, b, &hi);
+#else
+        return mul_wide_halves(a, b, hi);
+#endif
+    }
+
+    // return low word of a * b + c + d (never overflows two words), store high word to hi
+    inline limb_t mul_add(limb_t a, limb_t b, limb_t c, limb_t d, limb_t& hi)
+    {
+#if defined(__SIZEOF_INT128__)
+        dlimb_t acc = static_cast<dlimb_t>(a) * b + c + d;
+        hi = static_cast<limb_t>(acc >> LIMB_BITS);
+        return static_cast<limb_t>(acc);
+#else
+        limb_t lo = mul_wide(a, b, hi);
+        lo += c;
+        hi += (lo < c);
+        lo += d;
+        hi += (lo < d);
+        return lo;
+#endif
+    }
+
+    // return a + b + carry, store outgoing carry (0 or 1) to carry
+    VT_CONSTEXPR limb_t add_carry(limb_t a, limb_t b, limb_t& carry)
+    {
+        limb_t sum = a + carry;
+        limb_t overflow = (sum < carry);
+        sum += b;
+        carry = overflow + (sum < b);
+        return sum;
+    }
+
+    // return a - b - borrow, store outgoing borrow (0 or 1) to borrow
+    VT_CONSTEXPR limb_t sub_borrow(limb_t a, limb_t b, limb_t& borrow)
+    {
+        limb_t diff = a - b;
+        limb_t underflow = (a < b);
+        underflow += (diff < borrow);
+        diff -= borrow;
+        borrow = underflow;
+        return diff;
+    }
+
+    // count leading zero bits, x must not be 0
+    inline int count_leading_zeros(limb_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_clzll(x);
+#else
+        int n = 0;
+        while (!(x & (static_cast<limb_t>(1) << (LIMB_BITS - 1))))
+        {
+            x <<= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    // count trailing zero bits, x must not be 0
+    inline int count_trailing_zeros(limb_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while (!(x & 1))
+        {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    inline int popcount(limb_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    // divide two-word number (hi:lo) by d, hi must be less than d;
+    // return quotient, store remainder to rem
+    inline limb_t div_wide(limb_t hi, limb_t lo, limb_t d, limb_t& rem)
+    {
+#if defined(__SIZEOF_INT128__)
+        dlimb_t n = (static_cast<dlimb_t>(hi) << LIMB_BITS) | lo;
+        rem = static_cast<limb_t>(n % d);
+        return static_cast<limb_t>(n / d);
+#else
+        // Hacker's Delight divlu: normalise and produce two 32-bit quotient digits
+        const limb_t half = 1ULL << 32;
+        int shift = count_leading_zeros(d);
+        d <<= shift;
+        if (shift != 0)
+        {
+            hi = (hi << shift) | (lo >> (LIMB_BITS - shift));
+            lo <<= shift;
+        }
+
+        limb_t d1 = d >> 32, d0 = d & 0xffffffffULL;
+        limb_t lo1 = lo >> 32, lo0 = lo & 0xffffffffULL;
+
+        limb_t q1 = hi / d1;
+        limb_t r = hi - q1 * d1;
+        while (q1 >= half || q1 * d0 > ((r << 32) | lo1))
+        {
+            --q1;
+            r += d1;
+            if (r >= half) break;
+        }
+
+        limb_t mid = (hi << 32) + lo1 - q1 * d;
+        limb_t q0 = mid / d1;
+        r = mid - q0 * d1;
+        while (q0 >= half || q0 * d0 > ((r << 32) | lo0))
+        {
+            --q0;
+            r += d1;
+            if (r >= half) break;
+        }
+
+        rem = ((mid << 32) + lo0 - q0 * d) >> shift;
+        return (q1 << 32) | q0;
+#endif
+    }
+
+    /*
+        Low level routines on arrays of limbs, least significant limb first.
+        Sizes are in limbs, results may overlap operands only where noted.
+    */
+
+    // crossover points (in limbs) between algorithms, tune with a benchmark
+    struct Thresholds
+    {
+        int mul_karatsuba;      // schoolbook below, Karatsuba from here
+        int mul_toom3;          // Toom-3 from here
+        int mul_ntt;            // three-prime NTT from here, for squares too
+        int sqr_karatsuba;      // same as above for squaring
+        int sqr_toom3;
+        int div_newton;         // Newton reciprocal division when both divisor and quotient reach this
+        int str_dc;             // divide and conquer radix conversion from here
+        int mul_parallel;       // products split their work between threads from here, see set_threads()
+        int gcd_dc;             // half-GCD when both numbers reach this, Lehmer below
+    };
+    extern Thresholds thresholds;
+
+    /*
+        Scratch memory for temporary limbs of the routines below, one arena
+        per thread (a single shared one where thread_local is missing).
+        Arena blocks are taken from the heap when it first grows and then
+        reused by every later operation of the thread.
+        A frame hands out limbs and gives all of them back when it goes out
+        of scope, so frames must be nested like the calls that create them.
+    */
+    struct ScratchArena;
+
+    class ScratchFrame
+    {
+    public:
+        ScratchFrame();
+        ~ScratchFrame();
+
+        // n uninitialised limbs, valid while the frame lives
+        limb_t* alloc(size_t n);
+
+    private:
+        ScratchFrame(const ScratchFrame&);
+        ScratchFrame& operator=(const ScratchFrame&);
+
+        ScratchArena* _arena;
+        int _block;
+        size_t _used;
+    };
+
+    // return scratch blocks of the calling thread to the heap, no frame may be open
+    void release_scratch();
+
+    /*
+        Threads for multiplication of long operands, only the calling one by
+        default. Karatsuba and Toom-3 pointwise products and NTT transforms
+        are split into tasks for all threads; a thread that waits for its
+        tasks runs queued tasks meanwhile, so tasks may split further.
+        Results do not depend on the number of threads.
+        Without VT_HAS_THREADS everything runs on the calling thread.
+    */
+    // use count threads including the calling one, 0 for one per hardware thread;
+    // must not be called while multiplication is running
+    void set_threads(int count);
+    int threads();
+
+    // call task(index, argument) for every index in [0, count) on all threads, return when
+    // all calls are done; tasks must not throw
+    void parallel_for(int count, void (*task)(int index, void* argument), void* argument);
+
+    template <class Task>
+    void call_task(int index, void* task)
+    {
+        (*static_cast<Task*>(task))(index);
+    }
+
+    // same as above for task(index) of a function object
+    template <class Task>
+    inline void parallel_for(int count, Task& task)
+    {
+        parallel_for(count, &call_task<Task>, &task);
+    }
+
+    // r = a + b, return carry; r may be a or b
+    limb_t add_n(limb_t* r, const limb_t* a, const limb_t* b, int n);
+    limb_t add_1(limb_t* r, const limb_t* a, int n, limb_t b);
+    // an >= bn, r gets an limbs
+    limb_t add(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn);
+
+    // r = a - b, return borrow; r may be a or b
+    limb_t sub_n(limb_t* r, const limb_t* a, const limb_t* b, int n);
+    limb_t sub_1(limb_t* r, const limb_t* a, int n, limb_t b);
+    // an >= bn, r gets an limbs
+    limb_t sub(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn);
+
+    // return sign of a - b
+    int cmp(const limb_t* a, const limb_t* b, int n);
+    // return n without the most significant zero limbs
+    int normalized_size(const limb_t* a, int n);
+
+    // shift by 0 < count < LIMB_BITS, return bits shifted out; r may be a
+    limb_t lshift(limb_t* r, const limb_t* a, int n, int count);
+    limb_t rshift(limb_t* r, const limb_t* a, int n, int count);
+
+    // r = a * b, return high limb; r may be a
+    limb_t mul_1(limb_t* r, const limb_t* a, int n, limb_t b);
+    // r += a * b, return high limb
+    limb_t addmul_1(limb_t* r, const limb_t* a, int n, limb_t b);
+    // r -= a * b, return high limb to be subtracted further
+    limb_t submul_1(limb_t* r, const limb_t* a, int n, limb_t b);
+    // q = a / d, return remainder; q may be a
+    limb_t divrem_1(limb_t* q, const limb_t* a, int n, limb_t d);
+    // q = a / d, r = a % d by Knuth's algorithm D, an >= dn >= 2, top limb of d is not 0;
+    // q gets an - dn + 1 limbs, r gets dn limbs, neither may overlap a or d
+    void divrem(limb_t* q, limb_t* r, const limb_t* a, int an, const limb_t* d, int dn);
+
+    // Montgomery reduction r = t / B^n mod m: t < m * B^n has 2n limbs and is destroyed,
+    // m is odd with n limbs, m_inv == -m^-1 mod B; r gets n limbs
+    void redc(limb_t* r, limb_t* t, const limb_t* m, int n, limb_t m_inv);
+
+    // r = a * b, an >= bn >= 1, r gets an + bn limbs and must not overlap a or b
+    void mul_basecase(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn);
+    // same as above, using number-theoretic transform (VTNtt.cpp), O(n log n);
+    // a == b and an == bn saves a third of the transforms
+    void mul_ntt(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn);
+    // same as above, picks schoolbook, Karatsuba, Toom-3 or NTT by size; squares if a == b and an == bn
+    void mul(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn);
+
+    // r = a * a, r gets 2 * n limbs and must not overlap a;
+    // computes every cross product once, about half the work of schoolbook
+    void sqr_basecase(limb_t* r, const limb_t* a, int n);
+    // same as above, squaring counterparts of the mul() algorithms
+    void sqr(limb_t* r, const limb_t* a, int n);
+}
@@ -0,0 +1,295 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTMappedBignum.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace VTLimbs;
+
+namespace
+{
+    /*
+        File layout, all fields little-endian:
+            0   magic "VTBN"
+            4   format version, 32 bits
+            8   sign, 0 for + and 1 for -, 32 bits
+            12  reserved, 0
+            16  limb count, 64 bits
+            24  checksum of the limbs, 64 bits
+            32  limbs, least significant first
+        Limbs start at a multiple of 8 bytes from the file start,
+        so that a mapped file can be read as an array of limbs.
+    */
+    const char MAGIC[4] = { 'V', 'T', 'B', 'N' };
+    const unsigned VERSION = 1;
+    const int HEADER_BYTES = 32;
+
+    void store_le(unsigned char* bytes, limb_t value, int size)
+    {
+        for (int i = 0; i < size; ++i, value >>= 8)
+            bytes[i] = static_cast<unsigned char>(value);
+    }
+
+    limb_t load_le(const unsigned char* bytes, int size)
+    {
+        limb_t value = 0;
+        for (int i = size - 1; i >= 0; --i)
+            value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    // Fletcher style: sum of the limbs and sum of the running sums, mod 2^64;
+    // the second one tells the order of the limbs
+    limb_t checksum(const limb_t* limbs, limb_t n)
+    {
+        limb_t sum = 0;
+        limb_t order = 0;
+        for (limb_t i = 0; i < n; ++i)
+        {
+            sum += limbs[i];
+            order += sum;
+        }
+        return sum ^ ((order << 32) | (order >> 32));
+    }
+
+    // limb count of a file of size bytes from its header, throws unless save could have written it
+    limb_t read_header(const unsigned char* bytes, limb_t size, limb_t& sign)
+    {
+        if (memcmp(bytes, MAGIC, sizeof(MAGIC)) != 0)
+            throw std::runtime_error("Not a number file");
+        if (load_le(bytes + 4, 4) != VERSION)
+            throw std::runtime_error("Unsupported number file version");
+
+        sign = load_le(bytes + 8, 4);
+        limb_t n = load_le(bytes + 16, 8);
+        if (sign > 1 || n > (size - HEADER_BYTES) / LIMB_BYTES || size != HEADER_BYTES + n * LIMB_BYTES)
+            throw std::runtime_error("Number file is damaged");
+        if (n > static_cast<limb_t>(INT_MAX))
+            throw std::runtime_error("Number is too long");
+        return n;
+    }
+
+    // map the whole file read-only, populate reads it in at once
+    void* map_file(const char* path, size_t& size, bool populate)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  populate ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Failed to open number file");
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < HEADER_BYTES)
+        {
+            CloseHandle(file);
+            throw std::runtime_error("Not a number file");
+        }
+        size = static_cast<size_t>(file_size.QuadPart);
+
+        // the view keeps the file open
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        void* address = (mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (address == NULL)
+            throw std::runtime_error("Failed to map number file");
+        return address;
+#else
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Failed to open number file");
+
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size < HEADER_BYTES)
+        {
+            close(fd);
+            throw std::runtime_error("Not a number file");
+        }
+        size = static_cast<size_t>(status.st_size);
+
+        int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        if (populate)
+            flags |= MAP_POPULATE;
+#endif
+        // the mapping keeps the file open
+        void* address = mmap(NULL, size, PROT_READ, flags, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("Failed to map number file");
+#if defined(MADV_SEQUENTIAL)
+        if (populate)
+            madvise(address, size, MADV_SEQUENTIAL);
+#endif
+        return address;
+#endif
+    }
+
+    void unmap_file(void* address, size_t size)
+    {
+#if defined(_WIN32)
+        (void)size;
+        UnmapViewOfFile(address);
+#else
+        munmap(address, size);
+#endif
+    }
+}
+
+VTMappedBignum::VTMappedBignum(const char* path, bool verify): _address(NULL), _size(0), _view()
+{
+    if (!little_endian())
+        throw std::runtime_error("Mapped numbers need a little-endian machine");
+
+    _address = map_file(path, _size, verify);
+    try
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(_address);
+        limb_t sign;
+        limb_t n = read_header(bytes, _size, sign);
+
+        const limb_t* limbs = reinterpret_cast<const limb_t*>(bytes + HEADER_BYTES);
+        if (verify && checksum(limbs, n) != load_le(bytes + 24, 8))
+            throw std::runtime_error("Number file is damaged");
+
+        _view = VTBignumView(limbs, static_cast<int>(n), static_cast<int>(sign));
+    }
+    catch (...)
+    {
+        unmap_file(_address, _size);
+        throw;
+    }
+}
+
+VTMappedBignum::~VTMappedBignum()
+{
+    unmap_file(_address, _size);
+}
+
+void VTBignum::save(const char* path) const
+{
+    unsigned char header[HEADER_BYTES] = { 0 };
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    store_le(header + 4, VERSION, 4);
+    store_le(header + 8, _sign, 4);
+    store_le(header + 16, limbs(), 8);
+    store_le(header + 24, checksum(_chunks.begin(), limbs()), 8);
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        throw std::runtime_error("Failed to write number file");
+
+    bool written = (fwrite(header, 1, HEADER_BYTES, file) == static_cast<size_t>(HEADER_BYTES));
+    if (little_endian())
+    {
+        written = written && fwrite(_chunks.begin(), LIMB_BYTES, limbs(), file) == static_cast<size_t>(limbs());
+    }
+    else
+    {
+        unsigned char bytes[LIMB_BYTES];
+        for (int i = 0; written && i < limbs(); ++i)
+        {
+            store_le(bytes, _chunks[i], LIMB_BYTES);
+            written = (fwrite(bytes, 1, LIMB_BYTES, file) == static_cast<size_t>(LIMB_BYTES));
+        }
+    }
+
+    if (fclose(file) != 0)
+        written = false;
+    if (!written)
+        throw std::runtime_error("Failed to write number file");
+}
+
+VTBignum VTBignum::load(const char* path)
+{
+    if (little_endian())
+    {
+        // limbs are copied out of the mapping with memcpy
+        VTMappedBignum mapped(path);
+        return fromView(mapped.view());
+    }
+
+    // limbs can not be used in place, they are read a block at a time and put together byte by byte
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        throw std::runtime_error("Failed to open number file");
+
+    VTBignum result;
+    try
+    {
+        unsigned char header[HEADER_BYTES];
+        long size = -1;
+        if (fseek(file, 0, SEEK_END) == 0)
+            size = ftell(file);
+        rewind(file);
+        if (size < HEADER_BYTES || fread(header, 1, HEADER_BYTES, file) != static_cast<size_t>(HEADER_BYTES))
+            throw std::runtime_error("Not a number file");
+
+        limb_t sign;
+        int n = static_cast<int>(read_header(header, static_cast<limb_t>(size), sign));
+        result._chunks.resize(n);
+
+        const int BLOCK_LIMBS = 1024;
+        unsigned char bytes[BLOCK_LIMBS * LIMB_BYTES];
+        for (int i = 0; i < n; )
+        {
+            int count = std::min(BLOCK_LIMBS, n - i);
+            if (fread(bytes, LIMB_BYTES, count, file) != static_cast<size_t>(count))
+                throw std::runtime_error("Number file is damaged");
+            for (int k = 0; k < count; ++k, ++i)
+                result._chunks[i] = load_le(bytes + k * LIMB_BYTES, LIMB_BYTES);
+        }
+        if (checksum(result._chunks.begin(), n) != load_le(header + 24, 8))
+            throw std::runtime_error("Number file is damaged");
+
+        result._chunks.resize(normalized_size(result._chunks.begin(), n));
+        result._sign = ( result.limbs() > 0 ? static_cast<char>(sign) : 0 );
+    }
+    catch (...)
+    {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+    return result;
+}
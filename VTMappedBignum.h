@@ -0,0 +1,60 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#pragma once
+
+#include <stddef.h>
+
+#include "VTBignum.h"
+
+/*
+    Number saved by VTBignum::save, mapped into memory read-only. Its limbs
+    are used in place through view(), so opening a file of any size costs
+    no copy; pages are read in as the limbs are first touched.
+    Limbs are stored little-endian, so mapping needs a little-endian machine;
+    VTBignum::load reads the files anywhere.
+*/
+class VTMappedBignum
+{
+public:
+    // throws std::runtime_error like VTBignum::load; verify reads every limb
+    // to check the checksum, otherwise only the header is checked
+    explicit VTMappedBignum(const char* path, bool verify = true);
+    ~VTMappedBignum();
+
+    inline const VTBignumView& view() const { return _view; }
+
+private:
+    // not copyable, the mapping has a single owner
+    VTMappedBignum(const VTMappedBignum&);
+    VTMappedBignum& operator=(const VTMappedBignum&);
+
+    void* _address;
+    size_t _size;
+    VTBignumView _view;
+};
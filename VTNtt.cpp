@@ -0,0 +1,548 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTLimbs.h"
+#include "VTStats.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <algorithm>
+
+/*
+    Exact multiplication with the number-theoretic transform.
+
+    Limbs are used as coefficients as they are. The cyclic convolution is
+    computed modulo three primes of the form c * 2^k + 1 below 2^63, and
+    every coefficient is restored with the Chinese remainder theorem.
+    The primes' product is about 2^183, so coefficients up to
+    2^55 * (2^64 - 1)^2 are restored exactly, which covers any
+    transform length the primes support.
+*/
+namespace VTLimbs
+{
+
+namespace
+{
+    struct NttPrime
+    {
+        limb_t modulus;
+        limb_t generator;   // primitive root
+    };
+
+    const NttPrime NTT_PRIMES[3] =
+    {
+        { 4179340454199820289ULL, 3 },      // 29 * 2^57 + 1
+        { 2485986994308513793ULL, 5 },      // 69 * 2^55 + 1
+        { 1945555039024054273ULL, 5 }       // 27 * 2^56 + 1
+    };
+
+    const int NTT_MAX_LOG = 55;
+
+    // arithmetic modulo odd p < 2^63 in Montgomery form (R = 2^64)
+    class Montgomery
+    {
+    public:
+        explicit Montgomery(limb_t modulus): p(modulus)
+        {
+            // Newton iteration for p^-1 mod 2^64, p * p == 1 (mod 8) gives first 3 bits
+            limb_t inverse = p;
+            for (int i = 0; i < 5; ++i)
+                inverse *= 2 - p * inverse;
+            neg_inverse = 0 - inverse;
+
+            limb_t r_mod_p = (0 - p) % p;
+            limb_t hi;
+            limb_t lo = mul_wide(r_mod_p, r_mod_p, hi);
+            div_wide(hi, lo, p, r_squared);
+        }
+
+        // (hi:lo) / R mod p, requires (hi:lo) < p * R
+        inline limb_t reduce(limb_t hi, limb_t lo) const
+        {
+            limb_t m = lo * neg_inverse;
+            limb_t mp_hi;
+            mul_wide(m, p, mp_hi);
+            // low words add up to exactly 0 or R
+            limb_t t = hi + mp_hi + (lo != 0);
+            return ( t >= p ? t - p : t );
+        }
+
+        inline limb_t mul(limb_t a, limb_t b) const
+        {
+            limb_t hi;
+            limb_t lo = mul_wide(a, b, hi);
+            return reduce(hi, lo);
+        }
+
+        inline limb_t add(limb_t a, limb_t b) const
+        {
+            limb_t sum = a + b;
+            return ( sum >= p ? sum - p : sum );
+        }
+
+        inline limb_t sub(limb_t a, limb_t b) const
+        {
+            return ( a >= b ? a - b : a + p - b );
+        }
+
+        // any 64-bit value to Montgomery form
+        inline limb_t to(limb_t a) const { return mul(a, r_squared); }
+        inline limb_t from(limb_t a) const { return reduce(0, a); }
+
+        // plain a^e, a in Montgomery form, result in Montgomery form
+        limb_t pow(limb_t a, limb_t e) const
+        {
+            limb_t result = to(1);
+            while (e > 0)
+            {
+                if (e & 1)
+                    result = mul(result, a);
+                a = mul(a, a);
+                e >>= 1;
+            }
+            return result;
+        }
+
+        limb_t p;
+
+    private:
+        limb_t neg_inverse;
+        limb_t r_squared;
+    };
+
+    // butterflies of one stage on x[j] and y[j] for j < count
+    inline void butterflies_forward(limb_t* x, limb_t* y, const limb_t* w, int count, const Montgomery& mont)
+    {
+        for (int j = 0; j < count; ++j)
+        {
+            limb_t u = x[j], v = y[j];
+            x[j] = mont.add(u, v);
+            y[j] = mont.mul(mont.sub(u, v), w[j]);
+        }
+    }
+
+    inline void butterflies_inverse(limb_t* x, limb_t* y, const limb_t* w, int count, const Montgomery& mont)
+    {
+        for (int j = 0; j < count; ++j)
+        {
+            limb_t u = x[j], v = mont.mul(y[j], w[j]);
+            x[j] = mont.add(u, v);
+            y[j] = mont.sub(u, v);
+        }
+    }
+
+    // decimation in frequency, natural order in, bit-reversed order out
+    void ntt_forward(limb_t* a, int n, const Montgomery& shared, const limb_t* roots)
+    {
+        // Montgomery objects are shared between threads by address, so a store
+        // to limbs might change them as far as the compiler knows; constants of
+        // a local copy can stay in registers
+        const Montgomery mont = shared;
+        for (int h = n / 2; h >= 1; h /= 2)
+        {
+            for (int start = 0; start < n; start += 2 * h)
+                butterflies_forward(a + start, a + start + h, &roots[h], h, mont);
+        }
+    }
+
+    // decimation in time with inverse roots, bit-reversed order in, natural order out (scaled by n)
+    void ntt_inverse(limb_t* a, int n, const Montgomery& shared, const limb_t* roots)
+    {
+        const Montgomery mont = shared;
+        for (int h = 1; h < n; h *= 2)
+        {
+            for (int start = 0; start < n; start += 2 * h)
+                butterflies_inverse(a + start, a + start + h, &roots[h], h, mont);
+        }
+    }
+
+    /*
+        Transforms on threads: the transform of n points is cut into pieces
+        of n / pieces points. Stages on blocks longer than a piece split their
+        butterflies between pieces, and once blocks are that short, they are
+        transformed independently, each by one task.
+    */
+    const int NTT_MIN_PIECE = 4096;
+
+    // power of two number of pieces for transform of n points, 1 for one thread
+    int ntt_pieces(int n)
+    {
+        int pieces = 1;
+        if (threads() > 1)
+        {
+            while (pieces < 4 * threads() && n / (2 * pieces) >= NTT_MIN_PIECE)
+                pieces *= 2;
+        }
+        return pieces;
+    }
+
+    // roots w_2h^j of one stage, h / pieces of them in every piece
+    struct RootsTask
+    {
+        limb_t* roots;
+        int h;
+        int pieces;
+        limb_t w;
+        const Montgomery* shared;
+
+        void operator()(int piece)
+        {
+            const Montgomery mont = *shared;
+            int first = h / pieces * piece;
+            limb_t x = mont.pow(w, first);
+            for (int j = first; j < first + h / pieces; ++j)
+            {
+                roots[h + j] = x;
+                x = mont.mul(x, w);
+            }
+        }
+    };
+
+    // roots[h + j] = w_2h^j for every power of two h < n, in Montgomery form
+    void fill_roots(limb_t* roots, const Montgomery& mont, limb_t generator, int n, bool inverse)
+    {
+        limb_t g = mont.to(generator);
+        int pieces = ntt_pieces(n);
+        for (int h = 1; h < n; h *= 2)
+        {
+            limb_t w = mont.pow(g, (mont.p - 1) / (2 * h));
+            if (inverse)
+                w = mont.pow(w, mont.p - 2);
+
+            RootsTask task = { roots, h, (h >= pieces * NTT_MIN_PIECE ? pieces : 1), w, &mont };
+            parallel_for(task.pieces, task);
+        }
+    }
+
+    struct NttTask
+    {
+        limb_t* a;
+        int n;
+        int pieces;
+        int h;              // stage of split butterflies, 0 for independent blocks
+        bool inverse;
+        const Montgomery* shared;
+        const limb_t* roots;
+
+        void operator()(int piece)
+        {
+            const Montgomery mont = *shared;
+            if (h == 0)
+            {
+                limb_t* block = a + piece * (n / pieces);
+                if (inverse)
+                    ntt_inverse(block, n / pieces, mont, roots);
+                else
+                    ntt_forward(block, n / pieces, mont, roots);
+                return;
+            }
+
+            // piece is within one half of a block of 2h points
+            int size = n / 2 / pieces;
+            int first = piece * size;
+            limb_t* x = a + first / h * 2 * h + first % h;
+            if (inverse)
+                butterflies_inverse(x, x + h, &roots[h + first % h], size, mont);
+            else
+                butterflies_forward(x, x + h, &roots[h + first % h], size, mont);
+        }
+    };
+
+    void ntt(limb_t* a, int n, const Montgomery& mont, const limb_t* roots, bool inverse)
+    {
+        int pieces = ntt_pieces(n);
+        NttTask task = { a, n, pieces, 0, inverse, &mont, roots };
+        if (pieces == 1)
+            task(0);
+        else if (inverse)
+        {
+            parallel_for(pieces, task);
+            for (task.h = n / pieces; task.h < n; task.h *= 2)
+                parallel_for(pieces, task);
+        }
+        else
+        {
+            for (task.h = n / 2; task.h >= n / pieces; task.h /= 2)
+                parallel_for(pieces, task);
+            task.h = 0;
+            parallel_for(pieces, task);
+        }
+    }
+
+    // r[i] = f(a[i]) for i < n, split between threads
+    template <class Function>
+    struct MapTask
+    {
+        limb_t* r;
+        const limb_t* a;
+        int n;
+        int pieces;
+        Function f;
+
+        void operator()(int piece)
+        {
+            // local copy, like the Montgomery ones below
+            const Function local = f;
+            int first = static_cast<int>(static_cast<long long>(n) * piece / pieces);
+            int last = static_cast<int>(static_cast<long long>(n) * (piece + 1) / pieces);
+            for (int i = first; i < last; ++i)
+                r[i] = local(a[i]);
+        }
+    };
+
+    template <class Function>
+    void map_limbs(limb_t* r, const limb_t* a, int n, const Function& f)
+    {
+        MapTask<Function> task = { r, a, n, ntt_pieces(n), f };
+        parallel_for(task.pieces, task);
+    }
+
+    // fa[i] = fa[i] * fb[i], split between threads
+    struct PointwiseTask
+    {
+        limb_t* fa;
+        const limb_t* fb;
+        int n;
+        int pieces;
+        const Montgomery* shared;
+
+        void operator()(int piece)
+        {
+            const Montgomery mont = *shared;
+            for (int i = piece * (n / pieces); i < (piece + 1) * (n / pieces); ++i)
+                fa[i] = mont.mul(fa[i], fb[i]);
+        }
+    };
+
+    // plain value to Montgomery form
+    struct ToMontgomery
+    {
+        Montgomery mont;
+        limb_t operator()(limb_t a) const { return mont.to(a); }
+    };
+
+    // product with a fixed factor
+    struct MulBy
+    {
+        Montgomery mont;
+        limb_t factor;
+        limb_t operator()(limb_t a) const { return mont.mul(a, factor); }
+    };
+
+    // residues of the convolution of a and b (a with itself when b == a) modulo one prime, len coefficients;
+    // fa, fb and roots are scratch space of n limbs each
+    void convolve_mod(limb_t* residues, int len, const NttPrime& prime, int n,
+                      const limb_t* a, int an, const limb_t* b, int bn,
+                      limb_t* fa, limb_t* fb, limb_t* roots)
+    {
+        Montgomery mont(prime.modulus);
+        ToMontgomery to_montgomery = { mont };
+
+        map_limbs(fa, a, an, to_montgomery);
+        std::fill(fa + an, fa + n, 0);
+
+        fill_roots(roots, mont, prime.generator, n, false);
+        ntt(fa, n, mont, roots, false);
+
+        // square needs one forward transform
+        if (b == a && bn == an)
+        {
+            fb = fa;
+        }
+        else
+        {
+            map_limbs(fb, b, bn, to_montgomery);
+            std::fill(fb + bn, fb + n, 0);
+            ntt(fb, n, mont, roots, false);
+        }
+
+        PointwiseTask pointwise = { fa, fb, n, ntt_pieces(n), &mont };
+        parallel_for(pointwise.pieces, pointwise);
+
+        fill_roots(roots, mont, prime.generator, n, true);
+        ntt(fa, n, mont, roots, true);
+
+        // multiplying Montgomery form by plain n^-1 gives plain result
+        MulBy scale = { mont, mont.from(mont.pow(mont.to(n), prime.modulus - 2)) };
+        map_limbs(residues, fa, len, scale);
+    }
+
+    // convolution modulo every prime, on its own scratch for threads
+    struct ConvolveTask
+    {
+        limb_t* residues;
+        int len;
+        int n;
+        const limb_t* a;
+        int an;
+        const limb_t* b;
+        int bn;
+        limb_t* scratch;    // 3 * n limbs at every step
+        size_t step;        // between tasks, 0 when they run in turn
+
+        void operator()(int k)
+        {
+            limb_t* fa = scratch + step * k;
+            convolve_mod(residues + static_cast<size_t>(len) * k, len, NTT_PRIMES[k], n, a, an, b, bn, fa, fa + n, fa + 2 * n);
+        }
+    };
+
+    /*
+        Garner's algorithm: x = r1 + p1 * t2 + p1 * p2 * t3, where
+        t2 = (r2 - r1) / p1 mod p2, t3 = (r3 - r1 - p1 * t2) / (p1 * p2) mod p3
+    */
+    class Garner
+    {
+    public:
+        Garner(): p1(NTT_PRIMES[0].modulus), p2(NTT_PRIMES[1].modulus), p3(NTT_PRIMES[2].modulus),
+            mont2(p2), mont3(p3)
+        {
+            // constants in Montgomery form, so that mul() by them returns plain values
+            p1_inv_mont_p2 = mont2.pow(mont2.to(p1), p2 - 2);
+            p1_mont_p3 = mont3.to(p1);
+            p1p2_inv_mont_p3 = mont3.pow(mont3.mul(mont3.to(p1), mont3.to(p2)), p3 - 2);
+            p1p2_lo = mul_wide(p1, p2, p1p2_hi);
+        }
+
+        // three limbs x0, x1, x2 of the coefficient with the residues
+        void restore(limb_t r1, limb_t r2, limb_t r3, limb_t& x0, limb_t& x1, limb_t& x2) const
+        {
+            limb_t t2 = mont2.mul(mont2.sub(r2, r1 % p2), p1_inv_mont_p2);
+            limb_t t3 = mont3.sub(mont3.sub(r3, r1 % p3), mont3.mul(t2 % p3, p1_mont_p3));
+            t3 = mont3.mul(t3, p1p2_inv_mont_p3);
+
+            // x = r1 + p1 * t2 + (p1 * p2) * t3
+            x0 = mul_wide(p1, t2, x1);
+            limb_t c = 0;
+            x0 = add_carry(x0, r1, c);
+            x1 += c;
+
+            limb_t hi0, hi1;
+            limb_t lo0 = mul_wide(p1p2_lo, t3, hi0);
+            limb_t lo1 = mul_wide(p1p2_hi, t3, hi1);
+            c = 0;
+            x0 = add_carry(x0, lo0, c);
+            x1 = add_carry(x1, hi0, c);
+            x2 = hi1 + c;
+            c = 0;
+            x1 = add_carry(x1, lo1, c);
+            x2 += c;
+        }
+
+    private:
+        const limb_t p1, p2, p3;
+        Montgomery mont2, mont3;
+        limb_t p1_inv_mont_p2;
+        limb_t p1_mont_p3;
+        limb_t p1p2_inv_mont_p3;
+        limb_t p1p2_lo, p1p2_hi;
+    };
+
+    // product limbs from the residues, split between threads; every piece leaves
+    // its two limb carry out to be added to the limbs after it
+    struct GarnerTask
+    {
+        limb_t* r;
+        int rn;
+        const limb_t* residues;
+        int len;
+        int pieces;
+        limb_t* carries;    // two limbs for every piece
+        const Garner* garner;
+
+        void operator()(int piece)
+        {
+            int first = static_cast<int>(static_cast<long long>(rn) * piece / pieces);
+            int last = static_cast<int>(static_cast<long long>(rn) * (piece + 1) / pieces);
+
+            limb_t carry0 = 0, carry1 = 0;
+            for (int i = first; i < last; ++i)
+            {
+                limb_t x0 = 0, x1 = 0, x2 = 0;
+                if (i < len)
+                    garner->restore(residues[i], residues[len + i], residues[2 * static_cast<size_t>(len) + i], x0, x1, x2);
+
+                limb_t c = 0;
+                r[i] = add_carry(x0, carry0, c);
+                carry0 = add_carry(x1, carry1, c);
+                carry1 = x2 + c;
+            }
+            carries[2 * piece] = carry0;
+            carries[2 * piece + 1] = carry1;
+        }
+    };
+}
+
+void mul_ntt(limb_t* r, const limb_t* a, int an, const limb_t* b, int bn)
+{
+    assert(an >= 1 && bn >= 1);
+    VT_STAT_TIER(Stat_mul_ntt);
+
+    int len = an + bn - 1;      // coefficients of the product
+    int n = 1;
+    int log_n = 0;
+    while (n < len)
+    {
+        n *= 2;
+        ++log_n;
+    }
+    assert(log_n <= NTT_MAX_LOG);
+
+    // primes are taken in turn, or all at once by threads with their own scratch
+    int primes = (threads() > 1 ? 3 : 1);
+    ScratchFrame scratch;
+    limb_t* residues = scratch.alloc(3 * static_cast<size_t>(len));
+    ConvolveTask convolve = { residues, len, n, a, an, b, bn, scratch.alloc(primes * 3 * static_cast<size_t>(n)),
+                              (primes == 3 ? 3 * static_cast<size_t>(n) : 0) };
+    if (primes == 3)
+    {
+        parallel_for(3, convolve);
+    }
+    else
+    {
+        for (int k = 0; k < 3; ++k)
+            convolve(k);
+    }
+
+    Garner garner;
+    int pieces = ntt_pieces(n);
+    GarnerTask restore = { r, an + bn, residues, len, pieces, scratch.alloc(2 * pieces), &garner };
+    parallel_for(pieces, restore);
+
+    // carries out of the pieces, the last one is out of the product
+    for (int piece = 0; piece + 1 < pieces; ++piece)
+    {
+        int last = static_cast<int>(static_cast<long long>(an + bn) * (piece + 1) / pieces);
+        limb_t carry = add_1(r + last, r + last, an + bn - last, restore.carries[2 * piece]);
+        carry += add_1(r + last + 1, r + last + 1, an + bn - last - 1, restore.carries[2 * piece + 1]);
+        assert(carry == 0);
+    }
+    assert(restore.carries[2 * pieces - 2] == 0 && restore.carries[2 * pieces - 1] == 0);
+}
+
+}
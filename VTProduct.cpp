@@ -0,0 +1,234 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTBignum.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace VTLimbs;
+
+/*
+    Products of many numbers by binary splitting: the factors are multiplied
+    pairwise like leaves of a balanced tree, so that every long product has
+    operands of similar length and goes to the fast algorithms.
+*/
+
+// the two halves of a range, run on threads when the range is long
+struct VTBignum::ProductTask
+{
+    VTBignum* factors;
+    const long long* limbs;
+    int count;
+    VTBignum halves[2];
+
+    ProductTask(VTBignum* range, const long long* range_limbs, int range_count): factors(range), limbs(range_limbs), count(range_count)
+    {}
+
+    void operator()(int half)
+    {
+        int mid = count / 2;
+        if (half == 0)
+            halves[0] = multiply_range(factors, limbs, mid);
+        else
+            halves[1] = multiply_range(factors + mid, limbs + mid, count - mid);
+    }
+};
+
+VTBignum VTBignum::product_tree(std::vector<VTBignum>& factors)
+{
+    // one limb factors are multiplied into a single limb while it does not overflow
+    std::vector<VTBignum> leaves;
+    leaves.reserve(factors.size() + 1);
+    char sign = 0;
+    limb_t packed = 1;
+    for (size_t i = 0; i < factors.size(); ++i)
+    {
+        VTBignum& factor = factors[i];
+        if (factor.limbs() == 0)
+            return VTBignum();
+
+        sign ^= factor._sign;
+        factor._sign = 0;
+        if (factor.limbs() == 1)
+        {
+            limb_t hi;
+            limb_t lo = mul_wide(packed, factor._chunks[0], hi);
+            if (hi == 0)
+            {
+                packed = lo;
+                continue;
+            }
+            leaves.push_back(fromLimbs(&packed, 1));
+            packed = factor._chunks[0];
+        }
+        else
+        {
+            leaves.push_back(VTBignum());
+            swap(leaves.back(), factor);
+        }
+    }
+    if (packed != 1 || leaves.empty())
+        leaves.push_back(fromLimbs(&packed, 1));
+
+    // limbs[i] is the length of leaves before i, to tell long ranges
+    std::vector<long long> limbs(leaves.size() + 1, 0);
+    for (size_t i = 0; i < leaves.size(); ++i)
+        limbs[i + 1] = limbs[i] + leaves[i].limbs();
+
+    VTBignum result = multiply_range(&leaves[0], &limbs[0], static_cast<int>(leaves.size()));
+    result._sign = sign;
+    return result;
+}
+
+VTBignum VTBignum::multiply_range(VTBignum* factors, const long long* limbs, int count)
+{
+    VTBignum result;
+    if (count == 1)
+    {
+        swap(result, factors[0]);
+        return result;
+    }
+
+    ProductTask task(factors, limbs, count);
+    if (threads() > 1 && limbs[count] - limbs[0] >= thresholds.mul_parallel)
+    {
+        parallel_for(2, task);
+    }
+    else
+    {
+        task(0);
+        task(1);
+    }
+
+    multiply(task.halves[0], task.halves[1], result);
+    return result;
+}
+
+std::vector<char> VTBignum::prime_sieve(int n)
+{
+    std::vector<char> primes(n + 1, 1);
+    primes[0] = 0;
+    if (n >= 1)
+        primes[1] = 0;
+    for (long long p = 2; p * p <= n; ++p)
+    {
+        if (primes[p])
+        {
+            for (long long q = p * p; q <= n; q += p)
+                primes[q] = 0;
+        }
+    }
+    return primes;
+}
+
+/*
+    Prime swing (Luschny): n! = (n / 2)!^2 * swing(n), where swing(n) is
+    the product of p^e over primes p <= n with e = sum of floor(n / p^k) mod 2;
+    p^e <= n, so the factors of swing(n) are small integers.
+*/
+VTBignum VTBignum::factorial_swing(int n, const std::vector<char>& primes)
+{
+    // 20! still fits a limb
+    if (n <= 20)
+    {
+        limb_t small = 1;
+        for (int i = 2; i <= n; ++i)
+            small *= i;
+        return fromLimbs(&small, 1);
+    }
+
+    std::vector<long long> factors;
+    for (int p = 2; p <= n; ++p)
+    {
+        if (!primes[p])
+            continue;
+
+        long long power = 1;
+        for (int q = n / p; q > 0; q /= p)
+        {
+            if (q & 1)
+                power *= p;
+        }
+        if (power > 1)
+            factors.push_back(power);
+    }
+
+    VTBignum result = factorial_swing(n / 2, primes);
+    result.sqr();
+    result *= product(factors.begin(), factors.end());
+    return result;
+}
+
+VTBignum VTBignum::factorial(int n)
+{
+    if (n < 0)
+        throw std::runtime_error("Negative factorial");
+
+    return factorial_swing(n, prime_sieve(n));
+}
+
+VTBignum VTBignum::binomial(int n, int k)
+{
+    if (n < 0)
+        throw std::runtime_error("Negative binomial");
+    if (k < 0 || k > n)
+        return VTBignum();
+
+    k = std::min(k, n - k);
+
+    // few factors: n * (n - 1) * ... * (n - k + 1) / k!, with no sieve up to n
+    if (k <= n / 16)
+    {
+        std::vector<long long> factors;
+        for (int i = 0; i < k; ++i)
+            factors.push_back(n - i);
+        return product(factors.begin(), factors.end()) / factorial(k);
+    }
+
+    // exponent of p is the number of carries when adding k and n - k in base p (Kummer),
+    // so p^e <= n
+    std::vector<char> primes = prime_sieve(n);
+    std::vector<long long> factors;
+    for (int p = 2; p <= n; ++p)
+    {
+        if (!primes[p])
+            continue;
+
+        long long power = 1;
+        for (long long q = p; q <= n; q *= p)
+        {
+            if (n / q - k / q - (n - k) / q != 0)
+                power *= p;
+        }
+        if (power > 1)
+            factors.push_back(power);
+    }
+    return product(factors.begin(), factors.end());
+}
@@ -0,0 +1,422 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTBignum.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace VTLimbs;
+
+/*
+    Integer roots by Newton's iteration x <- x + (a - x^n) / (n x^(n - 1)) at
+    increasing precision. The root r of a >> nk and its remainder, found
+    recursively, give the lower bound x = r 2^k of the root of a and a - x^n
+    without a power. With k a bit under half the length of the root, one step
+    from there leaves an error below 1, and its quotient only has about k bits,
+    so that it is taken from the leading bits of the divisor. Every level then
+    costs a power of its own length and a short division, and all levels
+    together a few multiplications of the full length. The tangent of x^n lies
+    under the curve, so the step lands at or above the root and the last
+    correction only decrements, until x^n fits under a.
+*/
+
+namespace
+{
+    // ceil(log2(n)) for n >= 1
+    int log2_ceil(int n)
+    {
+        int bits = 0;
+        while ((1LL << bits) < n)
+            ++bits;
+        return bits;
+    }
+
+    // odd primes below 2^8; a number free of them has no p-th root below 2^8
+    const limb_t SMALL_PRIMES[] =
+    {
+        3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97,
+        101, 103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191,
+        193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251
+    };
+    const int SMALL_PRIME_COUNT = static_cast<int>(sizeof(SMALL_PRIMES) / sizeof(SMALL_PRIMES[0]));
+    const int SMALL_PRIME_BITS = 8;
+
+    // x mod q for q < 2^32, half a limb at a time, so that no double limb is needed
+    limb_t mod_small(const VTBignum& x, limb_t q)
+    {
+        limb_t r = 0;
+        for (int i = x.limbs() - 1; i >= 0; --i)
+        {
+            r = ((r << 32) | (x.limb(i) >> 32)) % q;
+            r = ((r << 32) | (x.limb(i) & 0xffffffff)) % q;
+        }
+        return r;
+    }
+
+    // x modulo each of SMALL_PRIMES, with one pass over the limbs for every product of them under 2^32
+    void small_residues(const VTBignum& x, limb_t* residues)
+    {
+        for (int i = 0; i < SMALL_PRIME_COUNT; )
+        {
+            limb_t product = 1;
+            int end = i;
+            while (end < SMALL_PRIME_COUNT && product * SMALL_PRIMES[end] < (static_cast<limb_t>(1) << 32))
+                product *= SMALL_PRIMES[end++];
+            limb_t r = mod_small(x, product);
+            for (; i < end; ++i)
+                residues[i] = r % SMALL_PRIMES[i];
+        }
+    }
+
+    // base^power mod q for q < 2^32
+    limb_t pow_mod_small(limb_t base, limb_t power, limb_t q)
+    {
+        limb_t result = 1;
+        for (; power > 0; power >>= 1)
+        {
+            if (power & 1)
+                result = result * base % q;
+            base = base * base % q;
+        }
+        return result;
+    }
+
+    /*
+        False if the number with the given small residues is certainly not a
+        p-th power for prime p: modulo a prime q = kp + 1 only one in p of the
+        non-zero residues is a p-th power, those with r^k == 1 (Euler's
+        criterion). Small p, whose roots are long, meet many such q.
+    */
+    bool power_residues(const limb_t* residues, int p)
+    {
+        for (int i = 0; i < SMALL_PRIME_COUNT; ++i)
+        {
+            limb_t q = SMALL_PRIMES[i];
+            if (q > static_cast<limb_t>(p) && (q - 1) % p == 0 && residues[i] != 0 && pow_mod_small(residues[i], (q - 1) / p, q) != 1)
+                return false;
+        }
+        return true;
+    }
+
+    // x mod 2^bits for x >= 0, from the low limbs only
+    VTBignum low_bits(const VTBignum& x, int bits)
+    {
+        VTBignumView view(x);
+        int n = std::min(view.limbs(), (bits + LIMB_BITS - 1) / LIMB_BITS);
+        if (n == 0)
+            return VTBignum();
+        std::vector<limb_t> low(view.data(), view.data() + n);
+        if (n * LIMB_BITS > bits)
+            low[n - 1] &= (static_cast<limb_t>(1) << (bits % LIMB_BITS)) - 1;
+        return VTBignum::fromLimbs(&low[0], n);
+    }
+
+    // x^power mod 2^bits
+    VTBignum pow_2adic(const VTBignum& x, int power, int bits)
+    {
+        VTBignum result = VTBignum::fromInt(1);
+        for (int i = log2_ceil(power + 1) - 1; i >= 0; --i)
+        {
+            result.sqr();
+            result = low_bits(result, bits);
+            if ((power >> i) & 1)
+                result = low_bits(result * x, bits);
+        }
+        return result;
+    }
+
+    // x^power mod 2^64
+    limb_t pow_word(limb_t x, int power)
+    {
+        limb_t result = 1;
+        for (int i = log2_ceil(power + 1) - 1; i >= 0; --i)
+        {
+            result *= result;
+            if ((power >> i) & 1)
+                result *= x;
+        }
+        return result;
+    }
+
+    // x^(-1/p) mod 2^64 for odd x and odd prime p, see root_2adic
+    limb_t inverse_root_word(limb_t x, int p, limb_t p_inverse)
+    {
+        limb_t z = 1;
+        for (int i = 0; i < 6; ++i)
+            z += z * (1 - x * pow_word(z, p)) * p_inverse;
+        return z;
+    }
+
+    // 1/p mod 2^64 for odd p
+    limb_t inverse_word(int p)
+    {
+        limb_t inverse = p;
+        for (int i = 0; i < 5; ++i)
+            inverse *= 2 - p * inverse;
+        return inverse;
+    }
+
+    /*
+        The only y mod 2^bits with y^p == x mod 2^bits, for odd x and odd prime p.
+        Newton's iteration z <- z + z (1 - x z^p) / p for z = x^(-1/p) needs no
+        division but the one by p, and doubles the correct low bits from z = 1;
+        the first 64 are found in single limbs. Then y = x z^(p - 1). Every
+        step is kept non-negative, 1 - x z^p as 2^precision - (x z^p - 1), so
+        that the truncations only copy low limbs.
+    */
+    VTBignum root_2adic(const VTBignum& x, int p, int bits)
+    {
+        limb_t p_inverse = inverse_word(p);
+        limb_t z_low = inverse_root_word(x.limb(0), p, p_inverse);
+
+        VTBignum z = VTBignum::fromLimbs(&z_low, 1);
+        VTBignum inverse = VTBignum::fromLimbs(&p_inverse, 1);
+        VTBignum one = VTBignum::fromInt(1);
+        VTBignum two = VTBignum::fromInt(2);
+        VTBignum prime = VTBignum::fromInt(p);
+        for (int precision = LIMB_BITS; precision < bits; )
+        {
+            precision = std::min(2 * precision, bits);
+            VTBignum modulus = one << precision;
+            VTBignum x_low = low_bits(x, precision);
+            inverse = low_bits(inverse * (modulus + two - low_bits(prime * inverse, precision)), precision);
+            VTBignum error = low_bits(x_low * pow_2adic(z, p, precision), precision) - one;
+            VTBignum step = low_bits(low_bits(z * error, precision) * inverse, precision);
+            z = low_bits(z + modulus - step, precision);
+        }
+
+        return low_bits(low_bits(x, bits) * pow_2adic(z, p - 1, bits), bits);
+    }
+}
+
+VTBignum VTBignum::isqrt(const VTBignum& a)
+{
+    VTBignum remainder;
+    return iroot(a, 2, remainder);
+}
+
+VTBignum VTBignum::isqrt(const VTBignum& a, VTBignum& remainder)
+{
+    return iroot(a, 2, remainder);
+}
+
+VTBignum VTBignum::iroot(const VTBignum& a, int n)
+{
+    VTBignum remainder;
+    return iroot(a, n, remainder);
+}
+
+VTBignum VTBignum::iroot(const VTBignum& a, int n, VTBignum& remainder)
+{
+    if (n < 1)
+        throw std::runtime_error("Non-positive root degree");
+    if (a._sign == 1 && n % 2 == 0)
+        throw std::runtime_error("Even root of negative number");
+    VT_STAT_OPERATION(Stat_root, a.limbs());
+
+    VTBignum magnitude(a);
+    magnitude._sign = 0;
+    VTBignum root, rest;
+    if (n == 1 || magnitude.limbs() == 0)
+        root = magnitude;
+    else
+        root = root_floor(magnitude, n, rest);
+
+    if (a._sign == 1)
+    {
+        root = -root;
+        rest = -rest;
+    }
+    // remainder may be a
+    swap(remainder, rest);
+    return root;
+}
+
+VTBignum VTBignum::root_floor(const VTBignum& a, int n, VTBignum& remainder)
+{
+    // bits of the root
+    int length = (a.bit_length() - 1) / n + 1;
+    if (length == 1)
+    {
+        remainder = a - fromInt(1);
+        return fromInt(1);
+    }
+
+    // error of the step below is about n * 2^(2k - length), k < length keeps the leading part positive
+    int k = std::max(1, (length - 2 - log2_ceil(n)) / 2);
+    VTBignum leading = a >> (n * k);
+    VTBignum x = root_floor(leading, n, remainder);
+
+    // d = a - (x 2^k)^n, with no power taken: x^n is leading - remainder
+    leading -= remainder;
+    leading <<= n * k;
+    VTBignum d = a - leading;
+
+    // step d / (n x^(n - 1) 2^(k (n - 1))) from below; the divisor is cut to its leading bits
+    // and d is rounded up, so that the step can only get longer
+    VTBignum divisor(x);
+    divisor.pow(n - 1);
+    divisor *= fromInt(n);
+    int cut = std::max(0, divisor.bit_length() - k - 2 * LIMB_BITS);
+    divisor >>= cut;
+    --d;
+    d >>= cut + k * (n - 1);
+    ++d;
+    d /= divisor;
+
+    // far from the root, with k short for large n, the step may overshoot, but the root is under (x + 1) 2^k
+    if (d.bit_length() > k)
+        d = (fromInt(1) << k) - fromInt(1);
+
+    /*
+        A step from below lands at or above the root, and at most one above it:
+        with 2k <= length - 2 - log2(n) the step from x 2^k, below the root by
+        e < 2^k, overshoots by (n - 1) e^2 / (2 root) times at most 1.4 for the
+        change of the derivative, which is under 0.35, and the cut divisor adds
+        less than 1 / (n x^(n - 1)) <= 1/8. When k is 1 for lack of bits, the
+        bound above leaves only the root and the one after it.
+    */
+    x <<= k;
+    x += d;
+    VTBignum power(x);
+    power.pow(n);
+    if (power > a)
+    {
+        if (n == 2)
+        {
+            // (x - 1)^2 = x^2 - 2x + 1
+            power -= x << 1;
+            ++power;
+            --x;
+        }
+        else
+        {
+            --x;
+            power = x;
+            power.pow(n);
+        }
+        assert(power <= a);
+    }
+    remainder = a - power;
+    return x;
+}
+
+/*
+    Perfect powers, with the bounds of GMP's mpz_perfect_power_p: only prime
+    exponents need to be tried, and a number with no odd prime factor below
+    2^8 has no root below 2^8, which leaves exponents under bits / 8. The
+    residues modulo small primes are taken once: they drop most exponents by
+    Euler's criterion. An odd exponent that is left gets its only possible
+    root from the low bits (2-adic Newton iteration at the length of the root),
+    which has to match the residues too before the full power is compared.
+*/
+bool VTBignum::is_perfect_power() const
+{
+    // 0, 1 and -1
+    if (limbs() == 0 || (limbs() == 1 && _chunks[0] == 1))
+        return true;
+
+    // this is +-2^t * m with odd m, the exponent of a power divides t
+    int t = 0;
+    while (_chunks[t / LIMB_BITS] == 0)
+        t += LIMB_BITS;
+    t += count_trailing_zeros(_chunks[t / LIMB_BITS]);
+    VTBignum m = *this >> t;
+    m._sign = 0;
+    int bits = m.bit_length();
+
+    if (bits == 1)
+    {
+        // 2^t for t > 1, -2^t only for an odd exponent, a factor of t other than 2
+        while (_sign == 1 && t % 2 == 0)
+            t /= 2;
+        return t > 1;
+    }
+
+    limb_t residues[SMALL_PRIME_COUNT];
+    small_residues(m, residues);
+    bool small_factor = false;
+    for (int i = 0; i < SMALL_PRIME_COUNT; ++i)
+        small_factor = small_factor || residues[i] == 0;
+
+    // m < 2^bits and the root is at least 3 > 2^1.5, or above 2^8 with no small factor
+    int max_power = (small_factor ? (2 * bits - 1) / 3 : (bits - 1) / SMALL_PRIME_BITS);
+    if (t > 0)
+        max_power = std::min(max_power, t);
+    std::vector<char> primes = prime_sieve(std::max(max_power, 1));
+
+    limb_t root_residues[SMALL_PRIME_COUNT];
+    VTBignum remainder;
+    // negative numbers are only odd powers
+    for (int p = (_sign == 1 ? 3 : 2); p <= max_power; ++p)
+    {
+        if (!primes[p] || (t > 0 && t % p != 0) || !power_residues(residues, p))
+            continue;
+
+        if (p == 2)
+        {
+            // odd squares are 1 modulo 8
+            if ((m._chunks[0] & 7) == 1)
+            {
+                root_floor(m, 2, remainder);
+                if (remainder.limbs() == 0)
+                    return true;
+            }
+            continue;
+        }
+
+        // the root is odd and below 2^root_bits, so it is the 2-adic root modulo 2^root_bits
+        int root_bits = (bits - 1) / p + 1;
+        VTBignum root;
+        bool match = true;
+        if (root_bits <= LIMB_BITS)
+        {
+            // a single limb, found and checked without a bignum
+            limb_t z = inverse_root_word(m._chunks[0], p, inverse_word(p));
+            limb_t y = m._chunks[0] * pow_word(z, p - 1);
+            if (root_bits < LIMB_BITS)
+                y &= (static_cast<limb_t>(1) << root_bits) - 1;
+            for (int i = 0; i < SMALL_PRIME_COUNT && match; ++i)
+                match = (pow_mod_small(y % SMALL_PRIMES[i], p, SMALL_PRIMES[i]) == residues[i]);
+            if (match)
+                root = VTBignum::fromLimbs(&y, 1);
+        }
+        else
+        {
+            root = root_2adic(m, p, root_bits);
+            small_residues(root, root_residues);
+            for (int i = 0; i < SMALL_PRIME_COUNT && match; ++i)
+                match = (pow_mod_small(root_residues[i], p, SMALL_PRIMES[i]) == residues[i]);
+        }
+        if (match && root.pow(p) == m)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,125 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTLimbs.h"
+#include "VTStats.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <vector>
+
+namespace VTLimbs
+{
+
+/*
+    Blocks of growing size, used as one stack: current block is filled
+    from the start, and the next block is taken when a request does not fit.
+    Blocks are kept after use, one that turns out too small is replaced.
+*/
+struct ScratchArena
+{
+    ScratchArena(): block(-1), used(0)
+    {}
+
+    ~ScratchArena()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < blocks.size(); ++i)
+            delete[] blocks[i];
+        blocks.clear();
+        sizes.clear();
+    }
+
+    std::vector<limb_t*> blocks;
+    std::vector<size_t> sizes;
+    int block;          // current block, -1 before the first one
+    size_t used;        // limbs taken from the current block
+};
+
+namespace
+{
+    const size_t MIN_BLOCK = 4096;
+
+#if defined(VT_HAS_THREAD_LOCAL)
+    thread_local ScratchArena arena;
+#else
+    ScratchArena arena;
+#endif
+}
+
+ScratchFrame::ScratchFrame(): _arena(&arena), _block(arena.block), _used(arena.used)
+{}
+
+ScratchFrame::~ScratchFrame()
+{
+    _arena->block = _block;
+    _arena->used = _used;
+}
+
+limb_t* ScratchFrame::alloc(size_t n)
+{
+    ScratchArena& a = *_arena;
+    if (a.block < 0 || a.used + n > a.sizes[a.block])
+    {
+        size_t next = static_cast<size_t>(a.block + 1);
+        size_t size = std::max(n, std::max(MIN_BLOCK, (next > 0 ? 2 * a.sizes[next - 1] : 0)));
+        if (next == a.blocks.size())
+        {
+            a.blocks.push_back(new limb_t[size]);
+            VT_STAT_ALLOCATION(size * sizeof(limb_t));
+            a.sizes.push_back(size);
+        }
+        else if (a.sizes[next] < n)
+        {
+            delete[] a.blocks[next];
+            a.blocks[next] = 0;
+            a.sizes[next] = 0;
+            a.blocks[next] = new limb_t[size];
+            VT_STAT_ALLOCATION(size * sizeof(limb_t));
+            a.sizes[next] = size;
+        }
+        a.block = static_cast<int>(next);
+        a.used = 0;
+    }
+
+    limb_t* p = a.blocks[a.block] + a.used;
+    a.used += n;
+    return p;
+}
+
+void release_scratch()
+{
+    assert(arena.block < 0);
+    arena.clear();
+}
+
+}
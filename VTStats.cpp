@@ -0,0 +1,275 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTStats.h"
+
+#include <string.h>
+
+#if defined(VTBIGNUM_STATS)
+#if defined(VT_HAS_THREADS)
+#include <chrono>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+#endif
+
+namespace VTLimbs
+{
+
+namespace
+{
+    const char* const OPERATION_NAMES[STAT_OPERATIONS] =
+    {
+        "add", "sub", "mul", "sqr", "fma", "div", "pow", "pow_modulo", "to_string", "from_string", "gcd", "root", "other"
+    };
+
+    const char* const TIER_NAMES[STAT_TIERS] =
+    {
+        "mul_basecase", "sqr_basecase", "mul_karatsuba", "sqr_karatsuba", "mul_toom3", "sqr_toom3", "mul_ntt",
+        "div_knuth", "div_newton", "montgomery", "radix_conversion", "gcd_lehmer", "gcd_half"
+    };
+}
+
+const char* stat_name(StatOperation operation)
+{
+    return OPERATION_NAMES[operation];
+}
+
+const char* stat_name(StatTier tier)
+{
+    return TIER_NAMES[tier];
+}
+
+#if defined(VTBIGNUM_STATS)
+
+namespace
+{
+#if defined(VT_HAS_THREADS)
+    typedef std::atomic<unsigned long long> Counter;
+
+    inline void add(Counter& counter, unsigned long long value) { counter.fetch_add(value, std::memory_order_relaxed); }
+    inline unsigned long long read(const Counter& counter) { return counter.load(std::memory_order_relaxed); }
+
+    unsigned long long now()
+    {
+        return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+#else
+    typedef unsigned long long Counter;
+
+    inline void add(Counter& counter, unsigned long long value) { counter += value; }
+    inline unsigned long long read(const Counter& counter) { return counter; }
+
+    unsigned long long now()
+    {
+#if defined(_WIN32)
+        LARGE_INTEGER count, frequency;
+        QueryPerformanceCounter(&count);
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<unsigned long long>(count.QuadPart * 1e9 / frequency.QuadPart);
+#else
+        timeval time;
+        gettimeofday(&time, NULL);
+        return time.tv_sec * 1000000000ULL + time.tv_usec * 1000ULL;
+#endif
+    }
+#endif
+
+    // same layout as Stats, in counters that threads can share
+    struct Counters
+    {
+        Counter operations[STAT_OPERATIONS][4];     // calls, limbs, allocations, allocated bytes
+        Counter tiers[STAT_TIERS][2];               // calls, nanoseconds
+    };
+
+    // zero initialised as a static
+    Counters counters;
+
+#if defined(VT_HAS_THREAD_LOCAL)
+    thread_local int operation = Stat_other;
+    thread_local StatTimer* timer = 0;
+#else
+    int operation = Stat_other;
+    StatTimer* timer = 0;
+#endif
+}
+
+#if defined(VT_HAS_THREADS)
+std::atomic<bool> stats_on(false);
+#else
+bool stats_on = false;
+#endif
+
+void set_stats(bool enabled)
+{
+#if defined(VT_HAS_THREADS)
+    stats_on.store(enabled, std::memory_order_relaxed);
+#else
+    stats_on = enabled;
+#endif
+}
+
+bool stats_enabled()
+{
+    return stats_active();
+}
+
+Stats stats_snapshot()
+{
+    Stats stats;
+    for (int i = 0; i < STAT_OPERATIONS; ++i)
+    {
+        stats.operations[i].calls = read(counters.operations[i][0]);
+        stats.operations[i].limbs = read(counters.operations[i][1]);
+        stats.operations[i].allocations = read(counters.operations[i][2]);
+        stats.operations[i].allocated_bytes = read(counters.operations[i][3]);
+    }
+    for (int i = 0; i < STAT_TIERS; ++i)
+    {
+        stats.tiers[i].calls = read(counters.tiers[i][0]);
+        stats.tiers[i].nanoseconds = read(counters.tiers[i][1]);
+    }
+    return stats;
+}
+
+void reset_stats()
+{
+    for (int i = 0; i < STAT_OPERATIONS; ++i)
+    {
+        for (int k = 0; k < 4; ++k)
+            counters.operations[i][k] = 0;
+    }
+    for (int i = 0; i < STAT_TIERS; ++i)
+    {
+        for (int k = 0; k < 2; ++k)
+            counters.tiers[i][k] = 0;
+    }
+}
+
+void add_allocation(size_t bytes)
+{
+    add(counters.operations[operation][2], 1);
+    add(counters.operations[operation][3], bytes);
+}
+
+void StatScope::enter(StatOperation current, long long limbs)
+{
+    add(counters.operations[current][0], 1);
+    add(counters.operations[current][1], static_cast<unsigned long long>(limbs));
+    _operation = current;
+    _outer = operation;
+    operation = current;
+}
+
+void StatScope::leave()
+{
+    operation = _outer;
+}
+
+void StatScope::count_limbs(long long limbs)
+{
+    add(counters.operations[_operation][1], static_cast<unsigned long long>(limbs));
+}
+
+void StatTimer::start(StatTier tier)
+{
+    _tier = tier;
+    _inner = 0;
+    _outer = timer;
+    timer = this;
+    _start = now();
+}
+
+void StatTimer::stop()
+{
+    unsigned long long elapsed = now() - _start;
+    add(counters.tiers[_tier][0], 1);
+    add(counters.tiers[_tier][1], elapsed - _inner);
+
+    // a timer started before stats were switched on is not on the stack
+    timer = _outer;
+    if (_outer != 0)
+        _outer->_inner += elapsed;
+}
+
+int stat_operation()
+{
+    return operation;
+}
+
+void StatTask::enter(int current)
+{
+    _outer = operation;
+    _outer_timer = timer;
+    operation = current;
+    timer = 0;
+}
+
+void StatTask::leave()
+{
+    operation = _outer;
+    timer = _outer_timer;
+}
+
+void StatWait::start()
+{
+    _start = now();
+}
+
+void StatWait::stop()
+{
+    if (timer != 0)
+        timer->_inner += now() - _start;
+}
+
+#else
+
+void set_stats(bool)
+{}
+
+bool stats_enabled()
+{
+    return false;
+}
+
+Stats stats_snapshot()
+{
+    Stats stats;
+    memset(&stats, 0, sizeof(stats));
+    return stats;
+}
+
+void reset_stats()
+{}
+
+#endif
+
+}
@@ -0,0 +1,255 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#pragma once
+
+#include "VTLimbs.h"
+
+#if defined(VTBIGNUM_STATS) && defined(VT_HAS_THREADS)
+#include <atomic>
+#endif
+
+/*
+    Optional counters of the work done by VTBignum, for finding out where
+    the time goes. They are compiled in with VTBIGNUM_STATS defined, and
+    then collected while set_stats(true) is in effect; without the macro
+    the hooks are empty and cost nothing, and when collecting is off they
+    cost a test of a flag.
+
+    Every operation counts its calls, the limbs of its operands, and the
+    heap allocations (of number limbs and scratch blocks) made while it runs.
+    An operation run inside another one, like a product inside pow, counts
+    as itself and takes the allocations it makes.
+    Every algorithm tier counts its calls and its own time, without the time
+    of the tiers it calls: Karatsuba time leaves out the products of halves.
+    Tasks run on other threads (see parallel_for) count for the operation
+    that started them, and the wait for them is not own time of its tier.
+    All threads add to the same counters, a snapshot can be taken any time.
+*/
+namespace VTLimbs
+{
+    enum StatOperation
+    {
+        Stat_add, Stat_sub, Stat_mul, Stat_sqr, Stat_fma, Stat_div, Stat_pow, Stat_pow_modulo,
+        Stat_to_string, Stat_from_string, Stat_gcd, Stat_root,
+        Stat_other,         // allocations outside the operations above, e.g. copies
+        STAT_OPERATIONS
+    };
+
+    enum StatTier
+    {
+        Stat_mul_basecase, Stat_sqr_basecase, Stat_mul_karatsuba, Stat_sqr_karatsuba,
+        Stat_mul_toom3, Stat_sqr_toom3, Stat_mul_ntt,
+        Stat_div_knuth, Stat_div_newton, Stat_montgomery, Stat_radix_conversion,
+        Stat_gcd_lehmer, Stat_gcd_half,
+        STAT_TIERS
+    };
+
+    struct Stats
+    {
+        struct Operation
+        {
+            unsigned long long calls;
+            unsigned long long limbs;
+            unsigned long long allocations;
+            unsigned long long allocated_bytes;
+        };
+
+        struct Tier
+        {
+            unsigned long long calls;
+            unsigned long long nanoseconds;
+        };
+
+        Operation operations[STAT_OPERATIONS];
+        Tier tiers[STAT_TIERS];
+    };
+
+    // names for reports, like "mul" and "mul_karatsuba"
+    const char* stat_name(StatOperation operation);
+    const char* stat_name(StatTier tier);
+
+    // switch collecting on or off, it is off at start; no effect without VTBIGNUM_STATS
+    void set_stats(bool enabled);
+    bool stats_enabled();
+
+    // counters of all threads so far, zeros without VTBIGNUM_STATS
+    Stats stats_snapshot();
+    void reset_stats();
+
+#if defined(VTBIGNUM_STATS)
+
+#if defined(VT_HAS_THREADS)
+    extern std::atomic<bool> stats_on;
+    inline bool stats_active() { return stats_on.load(std::memory_order_relaxed); }
+#else
+    extern bool stats_on;
+    inline bool stats_active() { return stats_on; }
+#endif
+
+    void add_allocation(size_t bytes);
+    inline void count_allocation(size_t bytes)
+    {
+        if (stats_active())
+            add_allocation(bytes);
+    }
+
+    // operation of the current thread while in scope
+    class StatScope
+    {
+    public:
+        StatScope(StatOperation operation, long long limbs): _active(stats_active())
+        {
+            if (_active)
+                enter(operation, limbs);
+        }
+
+        ~StatScope()
+        {
+            if (_active)
+                leave();
+        }
+
+        // for operations that learn the size on the way, like reading text
+        void add_limbs(long long limbs)
+        {
+            if (_active)
+                count_limbs(limbs);
+        }
+
+    private:
+        void enter(StatOperation operation, long long limbs);
+        void leave();
+        void count_limbs(long long limbs);
+
+        bool _active;
+        int _operation;
+        int _outer;
+    };
+
+    // time of a tier while in scope, the inner timers of the thread are subtracted
+    class StatTimer
+    {
+    public:
+        explicit StatTimer(StatTier tier): _active(stats_active())
+        {
+            if (_active)
+                start(tier);
+        }
+
+        ~StatTimer()
+        {
+            if (_active)
+                stop();
+        }
+
+    private:
+        void start(StatTier tier);
+        void stop();
+
+        bool _active;
+        StatTier _tier;
+        unsigned long long _start;
+        unsigned long long _inner;      // nanoseconds of the timers inside this one
+        StatTimer* _outer;
+
+        friend class StatWait;
+    };
+
+    // operation of the current thread, handed to the threads that run its parallel tasks
+    int stat_operation();
+
+    // a parallel task while in scope: it runs for the operation that made it, outside the timers of the thread
+    class StatTask
+    {
+    public:
+        explicit StatTask(int operation): _active(stats_active())
+        {
+            if (_active)
+                enter(operation);
+        }
+
+        ~StatTask()
+        {
+            if (_active)
+                leave();
+        }
+
+    private:
+        void enter(int operation);
+        void leave();
+
+        bool _active;
+        int _outer;
+        StatTimer* _outer_timer;
+    };
+
+    // waiting for parallel tasks while in scope, not own time of the running timer
+    class StatWait
+    {
+    public:
+        StatWait(): _active(stats_active())
+        {
+            if (_active)
+                start();
+        }
+
+        ~StatWait()
+        {
+            if (_active)
+                stop();
+        }
+
+    private:
+        void start();
+        void stop();
+
+        bool _active;
+        unsigned long long _start;
+    };
+
+#endif
+}
+
+#if defined(VTBIGNUM_STATS)
+#define VT_STAT_OPERATION(operation, limbs) VTLimbs::StatScope vt_stat_operation((operation), (limbs))
+#define VT_STAT_TIER(tier) VTLimbs::StatTimer vt_stat_tier(tier)
+#define VT_STAT_ALLOCATION(bytes) VTLimbs::count_allocation(bytes)
+#define VT_STAT_LIMBS(limbs) vt_stat_operation.add_limbs(limbs)
+#define VT_STAT_CURRENT_OPERATION() VTLimbs::stat_operation()
+#define VT_STAT_TASK(operation) VTLimbs::StatTask vt_stat_task(operation)
+#define VT_STAT_WAIT() VTLimbs::StatWait vt_stat_wait
+#else
+#define VT_STAT_OPERATION(operation, limbs) ((void)0)
+#define VT_STAT_TIER(tier) ((void)0)
+#define VT_STAT_ALLOCATION(bytes) ((void)0)
+#define VT_STAT_LIMBS(limbs) ((void)0)
+#define VT_STAT_CURRENT_OPERATION() 0
+#define VT_STAT_TASK(operation) ((void)0)
+#define VT_STAT_WAIT() ((void)0)
+#endif
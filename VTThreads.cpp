@@ -0,0 +1,191 @@
+/*
+
+Copyright (c) 2012, Vitaly Turinsky
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the author may not be used to endorse or promote products
+   derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "VTLimbs.h"
+#include "VTStats.h"
+
+#if defined(VT_HAS_THREADS)
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+namespace VTLimbs
+{
+
+#if defined(VT_HAS_THREADS)
+
+namespace
+{
+    // calls of one parallel_for, kept on the stack of the calling thread
+    struct Job
+    {
+        void (*task)(int, void*);
+        void* argument;
+        int count;
+        int next;       // first index nobody has taken
+        int done;
+        int operation;  // of the calling thread, for VTBIGNUM_STATS
+    };
+
+    /*
+        Jobs with indices nobody has taken yet, oldest first. Indices are
+        taken one at a time under the lock, and the caller waits until every
+        index is done, so a job is not touched once its last call returns.
+    */
+    struct ThreadPool
+    {
+        ThreadPool(): stop(false)
+        {}
+
+        ~ThreadPool()
+        {
+            resize(1);
+        }
+
+        void resize(int threads)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            wake.notify_all();
+            for (size_t i = 0; i < workers.size(); ++i)
+                workers[i].join();
+            workers.clear();
+
+            stop = false;
+            for (int i = 1; i < threads; ++i)
+                workers.push_back(std::thread(&ThreadPool::run, this, static_cast<Job*>(0)));
+        }
+
+        // take the next index of own job, or of the oldest one; lock must be held
+        bool take(Job* own, Job*& job, int& index)
+        {
+            if (own != 0 && own->next < own->count)
+                job = own;
+            else if (!jobs.empty())
+                job = jobs.front();
+            else
+                return false;
+
+            index = job->next++;
+            if (job->next == job->count)
+                jobs.erase(std::find(jobs.begin(), jobs.end(), job));
+            return true;
+        }
+
+        // run tasks until own job is done, pool threads pass NULL and run until stop
+        void run(Job* own)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (own != 0 ? own->done < own->count : !stop)
+            {
+                Job* job;
+                int index;
+                if (take(own, job, index))
+                {
+                    lock.unlock();
+                    {
+                        VT_STAT_TASK(job->operation);
+                        job->task(index, job->argument);
+                    }
+                    lock.lock();
+                    if (++job->done == job->count)
+                        wake.notify_all();
+                }
+                else
+                {
+                    wake.wait(lock);
+                }
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable wake;       // new job, finished job or stop
+        std::deque<Job*> jobs;
+        std::vector<std::thread> workers;
+        bool stop;
+    };
+
+    ThreadPool pool;
+}
+
+void set_threads(int count)
+{
+    if (count <= 0)
+        count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    pool.resize(count);
+}
+
+int threads()
+{
+    return static_cast<int>(pool.workers.size()) + 1;
+}
+
+void parallel_for(int count, void (*task)(int index, void* argument), void* argument)
+{
+    if (pool.workers.empty() || count <= 1)
+    {
+        for (int i = 0; i < count; ++i)
+            task(i, argument);
+        return;
+    }
+
+    Job job = { task, argument, count, 0, 0, VT_STAT_CURRENT_OPERATION() };
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.jobs.push_back(&job);
+    }
+    pool.wake.notify_all();
+    VT_STAT_WAIT();
+    pool.run(&job);
+}
+
+#else
+
+void set_threads(int)
+{}
+
+int threads()
+{
+    return 1;
+}
+
+void parallel_for(int count, void (*task)(int index, void* argument), void* argument)
+{
+    for (int i = 0; i < count; ++i)
+        task(i, argument);
+}
+
+#endif
+
+}
@@ -27,10 +27,26 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 #include "VTBignum.h"
+#include "VTFixedBignum.h"
+#include "VTBignumBatch.h"
+#include "VTMappedBignum.h"
+
+#include <vector>
+#include <stdexcept>
+#include <utility>
+#include <sstream>
+#include <iomanip>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#if defined(VTBIGNUM_STATS) && defined(VT_HAS_THREADS)
+#include <chrono>
+#include <thread>
+#endif
+
 void test_plus(long long a, long long b, long long c)
 {
     VTBignum vta = VTBignum::fromLongLong(a);
@@ -61,12 +77,660 @@ void test_mult(long long a, long long b, long long c)
     assert(vtab == vtc);
 }
 
-VTBignum factorial(long long value)
+void test_div(long long a, long long b, long long q, long long r)
+{
+    VTBignum vta = VTBignum::fromLongLong(a);
+    VTBignum vtb = VTBignum::fromLongLong(b);
+    VTBignum vtq, vtr;
+    VTBignum::divmod(vta, vtb, vtq, vtr);
+
+    assert(vta / vtb == VTBignum::fromLongLong(q));
+    assert(vta % vtb == VTBignum::fromLongLong(r));
+    assert(vtq == VTBignum::fromLongLong(q) && vtr == VTBignum::fromLongLong(r));
+}
+
+// std::allocator that counts blocks in use
+struct CountingAllocator : std::allocator<VTLimbs::limb_t>
+{
+    static int blocks;
+
+    VTLimbs::limb_t* allocate(size_t n)
+    {
+        ++blocks;
+        return std::allocator<VTLimbs::limb_t>::allocate(n);
+    }
+
+    void deallocate(VTLimbs::limb_t* p, size_t n)
+    {
+        --blocks;
+        std::allocator<VTLimbs::limb_t>::deallocate(p, n);
+    }
+};
+int CountingAllocator::blocks = 0;
+
+// pseudo random number with given number of bytes
+VTBignum random_bignum(int size, unsigned seed, int sign = 0)
+{
+    std::vector<unsigned char> bytes(size);
+    for (int i = 0; i < size; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        bytes[i] = static_cast<unsigned char>(seed >> 16);
+    }
+    return VTBignum::fromByteArray(&bytes[0], size, sign);
+}
+
+// compare fast multiplication against schoolbook for operands of given sizes in bytes
+void test_mult_algorithms(int size_a, int size_b)
+{
+    VTBignum a = random_bignum(size_a, size_a, 1);
+    VTBignum b = random_bignum(size_b, size_b + 1);
+
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    VTLimbs::thresholds.mul_karatsuba = 1 << 30;
+    VTLimbs::thresholds.mul_toom3 = 1 << 30;
+    VTLimbs::thresholds.mul_ntt = 1 << 30;
+    VTBignum expected = a * b;
+
+    VTLimbs::thresholds.mul_karatsuba = 4;
+    VTLimbs::thresholds.mul_toom3 = 1 << 30;
+    assert( a * b == expected );
+
+    VTLimbs::thresholds.mul_karatsuba = 4;
+    VTLimbs::thresholds.mul_toom3 = 9;
+    assert( a * b == expected );
+    assert( b * a == expected );
+
+    VTLimbs::thresholds.mul_ntt = 1;
+    assert( a * b == expected );
+
+    VTLimbs::thresholds = saved;
+    assert( a * b == expected );
+}
+
+// compare squaring at every tier against schoolbook multiplication, size in bytes
+void test_sqr_algorithms(int size)
+{
+    VTBignum a = random_bignum(size, size + 2, 1);
+    VTBignum copy(a);
+
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    VTLimbs::thresholds.mul_karatsuba = 1 << 30;
+    VTLimbs::thresholds.mul_ntt = 1 << 30;
+    VTBignum expected = a * copy;
+
+    VTLimbs::thresholds.sqr_karatsuba = 1 << 30;
+    assert( VTBignum(a).sqr() == expected );
+
+    VTLimbs::thresholds.sqr_karatsuba = 4;
+    VTLimbs::thresholds.sqr_toom3 = 1 << 30;
+    assert( VTBignum(a).sqr() == expected );
+
+    VTLimbs::thresholds.sqr_toom3 = 9;
+    assert( a * a == expected );
+
+    VTLimbs::thresholds.mul_ntt = 1;
+    assert( VTBignum(a).sqr() == expected );
+
+    VTLimbs::thresholds = saved;
+    assert( VTBignum(a).sqr() == expected );
+}
+
+// compare products split between threads against the ones of a single thread, size in bytes
+void test_threads(int size)
+{
+    VTBignum a = random_bignum(size, size + 3, 1);
+    VTBignum b = random_bignum(size + 1000, size + 4);
+    VTBignum expected = a * b;
+    VTBignum square = VTBignum(a).sqr();
+
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    VTLimbs::set_threads(4);
+    VTLimbs::thresholds.mul_parallel = 8;
+    assert( a * b == expected );
+    assert( VTBignum(a).sqr() == square );
+
+    VTLimbs::thresholds.mul_ntt = 1 << 30;
+    assert( a * b == expected );
+    assert( VTBignum(a).sqr() == square );
+
+    VTLimbs::set_threads(1);
+    VTLimbs::thresholds = saved;
+}
+
+// compare Newton division against Knuth's algorithm for operands of given sizes in bytes
+void test_divide_algorithms(int size_a, int size_d)
+{
+    VTBignum a = random_bignum(size_a, size_a);
+    VTBignum d = random_bignum(size_d, size_d + 1, 1);
+
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    VTLimbs::thresholds.div_newton = 1 << 30;
+    VTBignum q, r;
+    VTBignum::divmod(a, d, q, r);
+    assert( q * d + r == a );
+    assert( r >= VTBignum() && r < -d );
+
+    VTLimbs::thresholds.div_newton = 8;
+    VTBignum q_newton, r_newton;
+    VTBignum::divmod(a, d, q_newton, r_newton);
+    assert( q_newton == q && r_newton == r );
+
+    // exact division
+    VTBignum::divmod(q * d, d, q_newton, r_newton);
+    assert( q_newton == q && r_newton == VTBignum() );
+
+    VTLimbs::thresholds = saved;
+}
+
+// compare fixed width arithmetic against VTBignum modulo 2^Bits
+template <int Bits>
+void test_fixed_bignum(unsigned seed)
+{
+    VTBignum modulus = VTBignum::fromInt(2);
+    modulus.pow(Bits);
+    VTBignum a = random_bignum((Bits + 7) / 8, seed) % modulus;
+    VTBignum b = random_bignum((Bits + 7) / 8, seed + 1) % modulus;
+
+    VTFixedBignum<Bits> fixed_a = VTFixedBignum<Bits>::fromBignum(a);
+    VTFixedBignum<Bits> fixed_b = VTFixedBignum<Bits>::fromBignum(b);
+    assert( fixed_a.toBignum() == a );
+    assert( VTFixedBignum<Bits>::fromString(a.toString().c_str()) == fixed_a );
+
+    assert( (fixed_a + fixed_b).toBignum() == (a + b) % modulus );
+    assert( (fixed_a - fixed_b).toBignum() == (a - b + modulus) % modulus );
+    assert( (fixed_a * fixed_b).toBignum() == a * b % modulus );
+    assert( fixed_a.full_product(fixed_b).toBignum() == a * b );
+    assert( (fixed_a < fixed_b) == (a < b) && (fixed_a >= fixed_b) == (a >= b) && fixed_a != fixed_b );
+
+    bool too_big = false;
+    try
+    {
+        VTFixedBignum<Bits>::fromBignum(modulus);
+    }
+    catch (std::runtime_error&)
+    {
+        too_big = true;
+    }
+    assert( too_big );
+}
+
+// compare batch routines at every instruction set against VTBignum, count is not a multiple of lanes
+void test_batch(int count, int limbs)
+{
+    VTBignum modulus = VTBignum::fromInt(2);
+    modulus.pow(VTLimbs::LIMB_BITS * limbs);
+
+    VTBignumBatch a(count, limbs), b(count, limbs);
+    for (int j = 0; j < count; ++j)
+    {
+        a.set(j, random_bignum(limbs * VTLimbs::LIMB_BYTES, j));
+        // equal numbers, numbers differing in the low limb and carries through all limbs
+        if (j % 3 == 0)
+            b.set(j, a.get(j) - VTBignum::fromInt(j % 2));
+        else if (j % 3 == 1)
+            b.set(j, modulus - a.get(j) - VTBignum::fromInt(j % 2));
+        else
+            b.set(j, random_bignum(limbs * VTLimbs::LIMB_BYTES, j + count));
+    }
+
+    VTBignumBatch::Simd saved = VTBignumBatch::simd();
+    for (int simd = VTBignumBatch::Simd_avx512; simd >= VTBignumBatch::Simd_none; --simd)
+    {
+        VTBignumBatch::set_simd(static_cast<VTBignumBatch::Simd>(simd));
+
+        VTBignumBatch sum(count, limbs), difference(count, limbs), product(count, 2 * limbs);
+        std::vector<unsigned char> carries(count), borrows(count);
+        std::vector<signed char> signs(count);
+        batch_add(sum, a, b, &carries[0]);
+        batch_sub(difference, a, b, &borrows[0]);
+        batch_mul(product, a, b);
+        batch_compare(&signs[0], a, b);
+
+        for (int j = 0; j < count; ++j)
+        {
+            VTBignum x = a.get(j), y = b.get(j);
+            assert( sum.get(j) + VTBignum::fromInt(carries[j]) * modulus == x + y );
+            assert( difference.get(j) - VTBignum::fromInt(borrows[j]) * modulus == x - y );
+            assert( product.get(j) == x * y );
+            assert( signs[j] == (x < y ? -1 : (x > y ? 1 : 0)) );
+        }
+    }
+    VTBignumBatch::set_simd(saved);
+}
+
+// store number of given size in bytes in every word layout and read it back;
+// check the bytes against toByteArray, and views against copies of the limbs
+void test_words(int size)
+{
+    VTBignum a = random_bignum(size, size, 1);
+    std::vector<unsigned char> bytes(a.size());
+    a.toByteArray(&bytes[0]);
+
+    const int word_sizes[] = { 1, 2, 3, 8, 16 };
+    for (int i = 0; i < int(sizeof(word_sizes) / sizeof(word_sizes[0])); ++i)
+    {
+        int word_size = word_sizes[i];
+        for (int order = VTBignum::Order_least_first; order <= VTBignum::Order_most_first; ++order)
+        {
+            for (int endian = VTBignum::Endian_little; endian <= VTBignum::Endian_big; ++endian)
+            {
+                VTBignum::WordOrder o = VTBignum::WordOrder(order);
+                VTBignum::Endian e = VTBignum::Endian(endian);
+                int count = a.words(word_size) + 1;
+                std::vector<unsigned char> words(count * word_size, 0xAA);
+                assert( a.toWords(&words[0], count, word_size, o, e) == 1 );
+                assert( VTBignum::fromWords(&words[0], count, word_size, o, e, 1) == a );
+
+                for (int j = 0; j < count * word_size; ++j)
+                {
+                    int word = (o == VTBignum::Order_least_first ? j / word_size : count - 1 - j / word_size);
+                    int byte = (e == VTBignum::Endian_little ? j % word_size : word_size - 1 - j % word_size);
+                    size_t index = word * word_size + byte;
+                    assert( words[j] == (index < bytes.size() ? bytes[index] : 0) );
+                }
+
+                bool thrown = false;
+                try { a.toWords(&words[0], count - 2, word_size, o, e); } catch (std::runtime_error&) { thrown = true; }
+                assert( thrown );
+            }
+        }
+    }
+    std::vector<unsigned char> native(a.words(4) * 4);
+    a.toWords(&native[0], a.words(4), 4, VTBignum::Order_most_first, VTBignum::Endian_native);
+    assert( VTBignum::fromWords(&native[0], a.words(4), 4, VTBignum::Order_most_first, VTBignum::Endian_native, 1) == a );
+
+    VTBignum b = random_bignum(size / 2 + 1, size + 1);
+    std::vector<VTLimbs::limb_t> limbs(b.limbs() + 2, 0);
+    for (int i = 0; i < b.limbs(); ++i)
+        limbs[i] = b.limb(i);
+    VTBignumView view(&limbs[0], int(limbs.size()));
+    assert( view.limbs() == b.limbs() && VTBignum::fromView(view) == b );
+    assert( view == b && b == view && a < view && view > a && view <= b && !(view != b) );
+    assert( a + view == a + b && view - a == b - a && a * view == a * b && view * view == b * b );
+
+    VTBignum c = a;
+    c += view;
+    c -= VTBignumView(&limbs[0], int(limbs.size()), 1);
+    assert( c == a + b + b );
+    c *= view;
+    assert( c == (a + b + b) * b );
+    c *= VTBignumView(c);
+    assert( c == VTBignum((a + b + b) * b).pow(2) );
+    assert( VTBignumView(&limbs[0], 0, 1).sign() == 0 && VTBignumView() == VTBignum() );
+}
+
+// write number of given size in bytes to streams and files and read it back
+void test_streams(int size)
+{
+    VTBignum a = random_bignum(size, size, 1);
+    VTBignum b = random_bignum(size / 3 + 1, size + 1);
+    std::string hex = a.toString(16);
+    if (hex[1] == '0')
+        hex.erase(1, 1);
+
+    std::stringstream text;
+    text << a << " " << b << " " << std::hex << a << " " << std::oct << b << " " << std::dec << VTBignum() << " x";
+    assert( text.str() == a.toString() + " " + b.toString() + " " + hex + " " + b.toString(8) + " 0 x" );
+
+    VTBignum values[5];
+    text >> values[0] >> values[1] >> std::hex >> values[2] >> std::oct >> values[3] >> std::dec >> values[4];
+    assert( text && values[0] == a && values[1] == b && values[2] == a && values[3] == b && !values[4] );
+    assert( !(text >> values[0]) && values[0] == a );
+
+    // formatting as for ints, the width only applies to the number
+    std::ostringstream padded, expected;
+    padded << "[" << std::setw(6) << VTBignum::fromInt(42) << "][" << 7 << "]"
+           << std::left << std::setfill('*') << std::setw(5) << VTBignum::fromInt(-3) << std::setw(5) << -3
+           << std::internal << std::setw(5) << VTBignum::fromInt(-3) << std::setw(5) << -3
+           << std::hex << std::uppercase << std::showbase << VTBignum::fromInt(255) << " " << 255
+           << " " << VTBignum() << " " << 0 << std::oct << " " << VTBignum::fromInt(8) << " " << 8
+           << std::dec << std::setw(3) << a << "|";
+    expected << "[" << std::setw(6) << 42 << "][" << 7 << "]"
+             << std::left << std::setfill('*') << std::setw(5) << -3 << std::setw(5) << -3
+             << std::internal << std::setw(5) << -3 << std::setw(5) << -3
+             << std::hex << std::uppercase << std::showbase << 255 << " " << 255
+             << " " << 0 << " " << 0 << std::oct << " " << 8 << " " << 8
+             << std::dec << a.toString() << "|";
+    assert( padded.str() == expected.str() );
+
+    FILE* file = tmpfile();
+    assert( file != NULL );
+    a.write_to(file);
+    fputs(" \n-0012 next", file);
+    rewind(file);
+    assert( VTBignum::read_from(file) == a );
+    assert( VTBignum::read_from(file) == VTBignum::fromInt(-12) );
+    assert( getc(file) == ' ' );
+    bool thrown = false;
+    try { VTBignum::read_from(file); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+
+    fclose(file);
+
+    // descriptors are read to the end
+    file = tmpfile();
+    assert( file != NULL );
+    b.write_to(fileno(file), 16);
+    rewind(file);
+    assert( VTBignum::read_from(fileno(file), 16) == b );
+    fclose(file);
+}
+
+// save numbers of given size in bytes, load and map them back, and reject damaged files
+void test_files(int size)
+{
+    const char* path = "VTBignum_test.tmp";
+    VTBignum a = random_bignum(size, size, 1);
+
+    a.save(path);
+    assert( VTBignum::load(path) == a );
+    {
+        VTMappedBignum mapped(path, false);
+        assert( mapped.view() == a && mapped.view().limbs() == a.limbs() );
+        assert( VTBignum(a).sqr() == mapped.view() * mapped.view() );
+    }
+
+    // flip a bit of the last limb, then cut the file short
+    FILE* file = fopen(path, "r+b");
+    fseek(file, -1, SEEK_END);
+    int last = getc(file);
+    fseek(file, -1, SEEK_END);
+    putc(last ^ 1, file);
+    fclose(file);
+    bool damaged = false;
+    try { VTBignum::load(path); } catch (std::runtime_error&) { damaged = true; }
+    assert( damaged );
+
+    file = fopen(path, "wb");
+    fputs("VTBN", file);
+    fclose(file);
+    bool short_file = false;
+    try { VTBignum::load(path); } catch (std::runtime_error&) { short_file = true; }
+    assert( short_file );
+
+    VTBignum().save(path);
+    assert( VTBignum::load(path) == VTBignum() );
+    remove(path);
+}
+
+// bit operations against long long, then identities on numbers of size bytes
+void test_bits(int size)
 {
-    VTBignum res = VTBignum::fromInt(1);
-    for (long long i = 1; i <= value; ++i)
-        res *= VTBignum::fromLongLong(i);
-    return res;
+    const long long values[] = { 0, 1, -1, 2, -2, 5, -5, 12345, -12345, 1LL << 40, -(1LL << 40), 9223372036854775807LL };
+    for (int i = 0; i < 12; ++i)
+    {
+        long long x = values[i];
+        VTBignum a = VTBignum::fromLongLong(x);
+        assert( ~a == VTBignum::fromLongLong(~x) );
+        assert( (a >> 3) == VTBignum::fromLongLong(x >> 3) && (a >> 100) == VTBignum::fromLongLong(x < 0 ? -1 : 0) );
+        assert( (a << 20) == VTBignum::fromLongLong(x) * VTBignum::fromLongLong(1 << 20) );
+        for (int k = 0; k < 70; ++k)
+            assert( a.test_bit(k) == (k < 63 ? ((x >> k) & 1) != 0 : x < 0) );
+        for (int j = 0; j < 12; ++j)
+        {
+            long long y = values[j];
+            VTBignum b = VTBignum::fromLongLong(y);
+            assert( (a & b) == VTBignum::fromLongLong(x & y) );
+            assert( (a | b) == VTBignum::fromLongLong(x | y) );
+            assert( (a ^ b) == VTBignum::fromLongLong(x ^ y) );
+        }
+    }
+
+    VTBignum a = random_bignum(size, 7, 1);
+    VTBignum b = random_bignum(size / 2 + 1, 8);
+    int bits = 8 * size + 3;
+    assert( (a << bits) == a * VTBignum::fromInt(2).pow(bits) && (b >> bits) == VTBignum() );
+    assert( ((a << 77) >> 77) == a && (a >> bits) == VTBignum::fromInt(-1) );
+    assert( (a & b) + (a | b) == a + b && (a ^ b) == (a | b) - (a & b) );
+    assert( (a & ~b) == (a ^ (a & b)) && ~~a == a && (a ^ a) == VTBignum() );
+    VTBignum one = VTBignum::fromInt(1);
+    assert( a.pow(0) == one );
+    assert( (a & -a) == (((a ^ (a - one)) + one) >> 1) );
+
+    VTBignum c = b;
+    c.set_bit(bits);
+    assert( c == b + VTBignum::fromInt(2).pow(bits) && c.test_bit(bits) && c.popcount() == b.popcount() + 1 );
+    c.set_bit(bits, false);
+    assert( c == b && (~b).popcount() == -1 );
+
+    // setting a bit in two's complement adds 2^k if it was clear
+    for (int k = 0; k < 200; k += 13)
+    {
+        VTBignum d = a;
+        d.set_bit(k, !a.test_bit(k));
+        VTBignum step = VTBignum::fromInt(2).pow(k);
+        assert( d == (a.test_bit(k) ? a - step : a + step) );
+    }
+    assert( VTBignum::fromInt(-1).popcount() == -1 && VTBignum::fromInt(255).popcount() == 8 );
+    assert( VTBignum::fromInt(-256).bit_length() == 9 && VTBignum().bit_length() == 0 );
+}
+
+// gcd, xgcd and modinv on small values, then on numbers of size bytes with a known common factor
+void test_gcd(int size)
+{
+    const int values[][3] = { {0, 0, 0}, {0, 7, 7}, {-7, 0, 7}, {12, 18, 6}, {-12, 18, 6}, {17, -5, 1}, {240, 46, 2} };
+    for (int i = 0; i < 7; ++i)
+    {
+        VTBignum a = VTBignum::fromInt(values[i][0]);
+        VTBignum b = VTBignum::fromInt(values[i][1]);
+        VTBignum s, t;
+        assert( VTBignum::gcd(a, b) == VTBignum::fromInt(values[i][2]) );
+        assert( VTBignum::xgcd(a, b, s, t) == VTBignum::fromInt(values[i][2]) && a * s + b * t == VTBignum::fromInt(values[i][2]) );
+    }
+    assert( VTBignum::modinv(VTBignum::fromInt(3), VTBignum::fromInt(7)) == VTBignum::fromInt(5) );
+    assert( VTBignum::modinv(VTBignum::fromInt(-3), VTBignum::fromInt(7)) == VTBignum::fromInt(2) );
+    assert( VTBignum::modinv(VTBignum::fromInt(5), VTBignum::fromInt(1)) == VTBignum() );
+    bool thrown = false;
+    try { VTBignum::modinv(VTBignum::fromInt(6), VTBignum::fromInt(9)); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+    thrown = false;
+    try { VTBignum::modinv(VTBignum::fromInt(6), VTBignum()); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    for (int dc = 0; dc < 2; ++dc)
+    {
+        // the second pass runs the half-GCD down to a few limbs
+        if (dc)
+            VTLimbs::thresholds.gcd_dc = 4;
+        VTBignum g = random_bignum(size / 3 + 1, 9);
+        VTBignum x = random_bignum(size, 10, 1);
+        VTBignum y = random_bignum(size - size / 4, 11) + VTBignum::fromInt(1);
+        VTBignum d = VTBignum::gcd(x, y);
+        assert( d == VTBignum::gcd(y, x) && (x % d) == VTBignum() && (y % d) == VTBignum() );
+        assert( VTBignum::gcd(x / d, y / d) == VTBignum::fromInt(1) );
+
+        VTBignum a = g * x;
+        VTBignum b = g * y;
+        VTBignum s, t;
+        VTBignum e = VTBignum::xgcd(a, b, s, t);
+        assert( e == VTBignum::gcd(a, b) && e == g * d && a * s + b * t == e );
+        // cofactors are bounded like in GMP
+        assert( s * s * VTBignum::fromInt(4) * e * e <= b * b && t * t * VTBignum::fromInt(4) * e * e <= a * a );
+
+        VTBignum m = y / d;
+        VTBignum inverse = VTBignum::modinv(x / d, m);
+        assert( inverse < m && ((x / d) * inverse - VTBignum::fromInt(1)) % m == VTBignum() );
+    }
+    VTLimbs::thresholds = saved;
+}
+
+// roots of small values, then of numbers of size bytes and of their powers
+void test_roots(int size)
+{
+    for (int x = 0; x <= 300; ++x)
+    {
+        VTBignum a = VTBignum::fromInt(x);
+        int root = 0;
+        while ((root + 1) * (root + 1) <= x)
+            ++root;
+        VTBignum remainder;
+        assert( VTBignum::isqrt(a, remainder) == VTBignum::fromInt(root) && remainder == VTBignum::fromInt(x - root * root) );
+        int cube = 0;
+        while ((cube + 1) * (cube + 1) * (cube + 1) <= x)
+            ++cube;
+        assert( VTBignum::iroot(-a, 3, remainder) == VTBignum::fromInt(-cube) && remainder == VTBignum::fromInt(cube * cube * cube - x) );
+        bool power = (x <= 1);
+        for (int y = 2; y * y <= x; ++y)
+            for (int z = y * y; z <= x; z *= y)
+                power = power || z == x;
+        assert( a.is_perfect_power() == power );
+    }
+    assert( VTBignum::fromInt(-8).is_perfect_power() && !VTBignum::fromInt(-4).is_perfect_power() );
+    assert( VTBignum::fromInt(-1).is_perfect_power() && !VTBignum::fromInt(-32 * 9).is_perfect_power() );
+    bool thrown = false;
+    try { VTBignum::isqrt(VTBignum::fromInt(-4)); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+    thrown = false;
+    try { VTBignum::iroot(VTBignum::fromInt(4), 0); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+
+    VTBignum a = random_bignum(size, 12);
+    const int degrees[] = { 2, 3, 5, 7, 64, 1000 };
+    for (int i = 0; i < 6; ++i)
+    {
+        int n = degrees[i];
+        VTBignum remainder;
+        VTBignum root = VTBignum::iroot(a, n, remainder);
+        VTBignum power = root;
+        power.pow(n);
+        VTBignum above = root + VTBignum::fromInt(1);
+        above.pow(n);
+        assert( power + remainder == a && remainder >= VTBignum() && above > a );
+
+        // exact powers have no remainder, one less is not a power
+        if (n > 7)
+            continue;
+        VTBignum x = random_bignum(size / n + 1, 13 + n) + VTBignum::fromInt(2);
+        VTBignum exact = x;
+        exact.pow(n);
+        assert( VTBignum::iroot(exact, n, remainder) == x && remainder == VTBignum() );
+        assert( exact.is_perfect_power() && (exact << (6 * n)).is_perfect_power() );
+        assert( VTBignum::iroot(exact - VTBignum::fromInt(1), n) == x - VTBignum::fromInt(1) );
+    }
+    assert( VTBignum::isqrt(a) == VTBignum::iroot(a, 2) && VTBignum::iroot(a, 1) == a && !a.is_perfect_power() );
+}
+
+#if defined(VTBIGNUM_STATS) && defined(VT_HAS_THREADS)
+// a parallel task that takes time without work
+void sleep_task(int, void*)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+#endif
+
+void test_stats()
+{
+    VTBignum a = random_bignum(3000 * 8, 5);
+    VTBignum b = random_bignum(1000 * 8, 6);
+
+    VTLimbs::set_stats(true);
+    VTLimbs::reset_stats();
+    VTBignum product = a * b;
+    VTBignum square = VTBignum(b).sqr();
+    VTBignum sum = a + b;
+    std::string text = b.toString(10);
+    VTLimbs::Stats stats = VTLimbs::stats_snapshot();
+    VTLimbs::set_stats(false);
+
+#if defined(VTBIGNUM_STATS)
+    assert( VTLimbs::stats_enabled() == false );
+    assert( stats.operations[VTLimbs::Stat_mul].calls >= 1 && stats.operations[VTLimbs::Stat_sqr].calls >= 1 );
+    assert( stats.operations[VTLimbs::Stat_add].calls == 1 && stats.operations[VTLimbs::Stat_add].limbs == 4000 );
+    assert( stats.operations[VTLimbs::Stat_mul].allocations >= 1 );
+    assert( stats.operations[VTLimbs::Stat_to_string].calls == 1 );
+    assert( stats.tiers[VTLimbs::Stat_mul_basecase].calls > 0 && stats.tiers[VTLimbs::Stat_radix_conversion].calls == 1 );
+    assert( stats.tiers[VTLimbs::Stat_montgomery].calls == 0 && stats.operations[VTLimbs::Stat_pow].calls == 0 );
+#else
+    assert( stats.operations[VTLimbs::Stat_mul].calls == 0 && stats.tiers[VTLimbs::Stat_mul_basecase].calls == 0 );
+#endif
+    assert( std::string(VTLimbs::stat_name(VTLimbs::Stat_sqr_toom3)) == "sqr_toom3" );
+
+#if defined(VTBIGNUM_STATS) && defined(VT_HAS_THREADS)
+    // tasks on other threads count for the operation that started them, waiting for them is not own time
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    VTLimbs::set_threads(4);
+    VTLimbs::thresholds.mul_parallel = 8;
+    VTBignum c = random_bignum(6000 * 8, 7);
+    VTBignum d = random_bignum(6000 * 8, 8);
+
+    VTLimbs::set_stats(true);
+    VTLimbs::reset_stats();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    VTBignum threaded = c * d;
+    unsigned long long wall = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    stats = VTLimbs::stats_snapshot();
+    {
+        VTLimbs::StatTimer timer(VTLimbs::Stat_gcd_half);
+        VTLimbs::parallel_for(2, sleep_task, NULL);
+    }
+    VTLimbs::Stats waited = VTLimbs::stats_snapshot();
+    VTLimbs::set_stats(false);
+    VTLimbs::set_threads(1);
+    VTLimbs::thresholds = saved;
+
+    unsigned long long own = 0;
+    for (int i = 0; i < VTLimbs::STAT_TIERS; ++i)
+        own += stats.tiers[i].nanoseconds;
+    assert( threaded == c * d );
+    assert( stats.operations[VTLimbs::Stat_mul].allocations >= 1 && stats.operations[VTLimbs::Stat_other].allocations == 0 );
+    // own times of one thread do not overlap
+    assert( own <= 4 * wall );
+    assert( waited.tiers[VTLimbs::Stat_gcd_half].calls == 1 && waited.tiers[VTLimbs::Stat_gcd_half].nanoseconds < 10000000 );
+#endif
+}
+
+// compare product trees, factorials and binomials against plain multiplication loops
+void test_products()
+{
+    VTBignum naive = VTBignum::fromInt(1);
+    for (int n = 0; n <= 1200; ++n)
+    {
+        if (n > 0)
+            naive *= VTBignum::fromInt(n);
+        if (n <= 30 || n % 97 == 0 || n == 1200)
+            assert( VTBignum::factorial(n) == naive );
+    }
+
+    const int sizes[][2] = { {0, 0}, {7, 0}, {7, 7}, {7, 3}, {40, 1}, {300, 7}, {1000, 300}, {1000, 500} };
+    for (int i = 0; i < int(sizeof(sizes) / sizeof(sizes[0])); ++i)
+    {
+        int n = sizes[i][0];
+        int k = sizes[i][1];
+        VTBignum c = VTBignum::binomial(n, k);
+        assert( c * VTBignum::factorial(k) * VTBignum::factorial(n - k) == VTBignum::factorial(n) );
+        assert( c == VTBignum::binomial(n, n - k) );
+    }
+    assert( VTBignum::binomial(5, 7) == VTBignum() );
+    assert( VTBignum::binomial(5, -1) == VTBignum() );
+    assert( VTBignum::binomial(52, 5) == VTBignum::fromInt(2598960) );
+
+    long long small[] = { 3, -5, 1LL << 40, 1LL << 40, 1LL << 40, -7, 11 };
+    assert( VTBignum::product(small, small) == VTBignum::fromInt(1) );
+    assert( VTBignum::product(small, small + 2) == VTBignum::fromInt(-15) );
+    assert( VTBignum::product(small, small + 7) == VTBignum::fromInt(1155) * VTBignum::fromLongLong(1LL << 40).pow(3) );
+
+    std::vector<VTBignum> numbers;
+    VTBignum expected = VTBignum::fromInt(1);
+    for (int i = 0; i < 200; ++i)
+    {
+        numbers.push_back(random_bignum(1 + i % 9 * 300, i, i % 3 == 0));
+        expected *= numbers.back();
+    }
+    assert( VTBignum::product(numbers.begin(), numbers.end()) == expected );
+
+    VTLimbs::Thresholds saved = VTLimbs::thresholds;
+    VTLimbs::set_threads(4);
+    VTLimbs::thresholds.mul_parallel = 8;
+    assert( VTBignum::product(numbers.begin(), numbers.end()) == expected );
+    assert( VTBignum::factorial(1200) == naive );
+    VTLimbs::set_threads(1);
+    VTLimbs::thresholds = saved;
+
+    numbers.push_back(VTBignum());
+    assert( VTBignum::product(numbers.begin(), numbers.end()) == VTBignum() );
 }
 
 // test cases
@@ -82,22 +746,22 @@ int main(int argc, char** argv)
     // test 1
     VTBignum bignum_result = bignum1 + bignum2;
 
-    unsigned char* bytes_result = (unsigned char*) malloc(bignum_result.size());
-    bignum_result.toByteArray(bytes_result);
+    unsigned char bytes_result[8];
+    bignum_result.toWords(bytes_result, sizeof(bytes_result), 1, VTBignum::Order_least_first, VTBignum::Endian_little);
 
     // test 2
     VTBignum bignum_result2 = bignum2 + bignum1;
 
-    unsigned char* bytes_result2 = (unsigned char*) malloc(bignum_result2.size());
-    bignum_result2.toByteArray(bytes_result2);
+    unsigned char bytes_result2[8];
+    bignum_result2.toWords(bytes_result2, sizeof(bytes_result2), 1, VTBignum::Order_least_first, VTBignum::Endian_little);
 
     assert(bignum_result == bignum_result2);
 
     assert( VTBignum::fromInt(0) == VTBignum() );
 
     assert( VTBignum::fromInt(-20000) < VTBignum::fromInt(20000) );
-    assert( VTBignum::fromInt(20000) < VTBignum::fromInt(-20000) == false );
-    assert( VTBignum::fromInt(20000) < VTBignum::fromInt(20000) == false );
+    assert( !(VTBignum::fromInt(20000) < VTBignum::fromInt(-20000)) );
+    assert( !(VTBignum::fromInt(20000) < VTBignum::fromInt(20000)) );
     assert( VTBignum::fromInt(21231) <= VTBignum::fromInt(21231) );
     assert( VTBignum::fromInt(3245) <= VTBignum::fromInt(3246) );
     assert( VTBignum::fromInt(1) <= VTBignum::fromInt(1234556) );
@@ -158,6 +822,13 @@ int main(int argc, char** argv)
     VTBignum frll = VTBignum::fromLongLong(-12345678);
     assert( VTBignum::fromString( "-12345678" ) == VTBignum::fromLongLong(-12345678) );
 
+    assert( VTBignum::fromString( "123456", 3 ) == VTBignum::fromInt(123) );
+    assert( VTBignum::fromString( "ffFF", -1, VTBignum::Base_16 ) == VTBignum::fromInt(65535) );
+    assert( VTBignum::fromString( "-10000000000000000", -1, VTBignum::Base_16 ).toString(16) == "-010000000000000000" );
+    bool bad_digit = false;
+    try { VTBignum::fromString( "1:", -1, VTBignum::Base_16 ); } catch (std::runtime_error&) { bad_digit = true; }
+    assert( bad_digit );
+
     // 2^64 == 2^16 * 2^16 * 2^16 * 2^16
     assert( VTBignum::fromString( "18446744073709551616" ) 
         == VTBignum::fromInt(65536) * VTBignum::fromInt(65536) * VTBignum::fromInt(65536) * VTBignum::fromInt(65536) );
@@ -170,6 +841,207 @@ int main(int argc, char** argv)
     VTBignum pow10 = VTBignum::fromInt(2).pow(10);
     assert( pow10 == VTBignum::fromInt(1024) );
 
+    // carries and borrows across limb boundaries
+    VTBignum two64 = VTBignum::fromString( "18446744073709551616" );
+    assert( two64.limbs() == 2 && two64.size() == 9 );
+    assert( two64 - VTBignum::fromInt(1) == VTBignum::fromString( "18446744073709551615" ) );
+    assert( (two64 - VTBignum::fromInt(1)).limbs() == 1 );
+    assert( VTBignum::fromInt(1) - two64 == VTBignum::fromString( "-18446744073709551615" ) );
+    assert( two64 * two64 == VTBignum::fromString( "340282366920938463463374607431768211456" ) );
+    assert( (two64 * two64 - VTBignum::fromInt(1)).toString() == "340282366920938463463374607431768211455" );
+    assert( VTBignum::fromString( "-340282366920938463463374607431768211455" ).toString() == "-340282366920938463463374607431768211455" );
+    assert( VTBignum::fromLongLong(-9223372036854775807LL - 1).toLongLong() == -9223372036854775807LL - 1 );
+    assert( two64 + VTBignum::fromInt(-1) == VTBignum::fromString( "18446744073709551615" ) );
+    assert( VTBignum::fromInt(-1) + two64 == VTBignum::fromString( "18446744073709551615" ) );
+    assert( VTBignum::fromInt(1) + (-two64) == VTBignum::fromString( "-18446744073709551615" ) );
+    assert( (-two64) - (-two64) == VTBignum() );
+    assert( two64 - (-two64) == two64 * VTBignum::fromInt(2) );
+    assert( !(VTBignum::fromInt(-5) > VTBignum::fromInt(-5)) );
+    assert( !(VTBignum::fromInt(-5) < VTBignum::fromInt(-5)) );
+
+    unsigned char bytes3[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0};
+    unsigned char bytes_result3[9];
+    VTBignum bignum3 = VTBignum::fromByteArray(bytes3, 11, 1);
+    assert( bignum3.size() == 9 && bignum3.limbs() == 2 );
+    assert( bignum3.toByteArray(bytes_result3) == 1 );
+    assert( memcmp(bytes3, bytes_result3, 9) == 0 );
+
+    test_mult_algorithms(800, 800);
+    test_mult_algorithms(801, 799);
+    test_mult_algorithms(4000, 3999);
+    test_mult_algorithms(5000, 700);
+    test_mult_algorithms(3000, 1);
+    test_mult_algorithms(40000, 40000);
+    test_sqr_algorithms(8);
+    test_sqr_algorithms(801);
+    test_sqr_algorithms(5000);
+
+    // NTT with largest possible coefficients: (2^n - 1)^2 == 2^2n - 2^(n+1) + 1
+    VTLimbs::Thresholds saved_thresholds = VTLimbs::thresholds;
+    VTLimbs::thresholds.mul_ntt = 1;
+    std::vector<unsigned char> ones(80000, 0xff);
+    VTBignum all_ones = VTBignum::fromByteArray(&ones[0], ones.size());
+    VTBignum two_n = all_ones + VTBignum::fromInt(1);
+    assert( all_ones * all_ones == two_n * two_n - two_n - two_n + VTBignum::fromInt(1) );
+    VTLimbs::thresholds = saved_thresholds;
+
+    test_div(7, 2, 3, 1);
+    test_div(-7, 2, -3, -1);
+    test_div(7, -2, -3, 1);
+    test_div(-7, -2, 3, -1);
+    test_div(6, 3, 2, 0);
+    test_div(2, 3, 0, 2);
+    test_div(0, 5, 0, 0);
+    test_div(9223372036854775807LL, 10, 922337203685477580LL, 7);
+
+    bool thrown = false;
+    try { VTBignum::fromInt(1) / VTBignum(); } catch (std::runtime_error&) { thrown = true; }
+    assert(thrown);
+
+    assert( two64 * two64 / two64 == two64 );
+    assert( (two64 * two64 + VTBignum::fromInt(5)) % two64 == VTBignum::fromInt(5) );
+
+    test_divide_algorithms(800, 8);
+    test_divide_algorithms(800, 100);
+    test_divide_algorithms(2000, 1000);
+    test_divide_algorithms(3000, 900);
+    test_divide_algorithms(3000, 1500);
+    test_divide_algorithms(40000, 1000);
+
+    assert( VTBignum::fromInt(4).pow_modulo(VTBignum::fromInt(13), VTBignum::fromInt(497)) == VTBignum::fromInt(445) );
+    assert( VTBignum::fromInt(-4).pow_modulo(VTBignum::fromInt(13), VTBignum::fromInt(-497)) == VTBignum::fromInt(52) );
+    assert( VTBignum::fromInt(7).pow_modulo(VTBignum(), VTBignum::fromInt(10)) == VTBignum::fromInt(1) );
+    assert( VTBignum::fromInt(7).pow_modulo(VTBignum::fromInt(5), VTBignum::fromInt(1)) == VTBignum() );
+
+    // Fermat's little theorem for Mersenne prime 2^127 - 1
+    VTBignum mersenne = VTBignum::fromInt(2).pow(127) - VTBignum::fromInt(1);
+    assert( VTBignum::fromInt(3).pow_modulo(mersenne - VTBignum::fromInt(1), mersenne) == VTBignum::fromInt(1) );
+
+    // Montgomery (odd modulus) and odd part with CRT (even modulus) paths against plain pow
+    VTBignum pow_base = random_bignum(40, 7);
+    VTBignum odd_mod = random_bignum(300, 8) * VTBignum::fromInt(2) + VTBignum::fromInt(1);
+    VTBignum even_mod = odd_mod + VTBignum::fromInt(1);
+    VTBignum pow_plain = VTBignum(pow_base).pow(300);
+    assert( pow_base.pow_modulo(VTBignum::fromInt(300), odd_mod) == pow_plain % odd_mod );
+    assert( pow_base.pow_modulo(VTBignum::fromInt(300), even_mod) == pow_plain % even_mod );
+    VTBignum power_of_two_mod = VTBignum::fromInt(2).pow(130);
+    assert( pow_base.pow_modulo(VTBignum::fromInt(300), power_of_two_mod) == pow_plain % power_of_two_mod );
+    assert( pow_base.pow_modulo(VTBignum::fromInt(300), odd_mod * power_of_two_mod) == pow_plain % (odd_mod * power_of_two_mod) );
+
+    std::string pow2_1000 = "10715086071862673209484250490600018105614048117055336074437503883703510511249361224931983788156958581275946729175531468251871452856923140435984577574698574803934567774824230985421074605062371141877954182153046474983581941267398767559165543946077062914571196477686542167660429831652624386837205668069376";
+    assert( VTBignum::fromInt(2).pow(1000).toString() == pow2_1000 );
+    assert( (-VTBignum::fromInt(2).pow(1000)).toString() == "-" + pow2_1000 );
+
+    // values moving between inline and heap storage
+    VTBignum small_value = VTBignum::fromInt(7);
+    VTBignum large_value = random_bignum(64, 10);
+    VTBignum large_copy = large_value;
+    swap(small_value, large_value);
+    assert( small_value == large_copy && large_value == VTBignum::fromInt(7) );
+    large_value *= large_copy;
+    assert( large_value / large_copy == VTBignum::fromInt(7) );
+    large_value = VTBignum::fromInt(-3);
+    assert( (large_value - large_copy + large_copy).toLongLong() == -3 );
+
+    // limb storage goes to the allocator only past the inline limbs
+    {
+        VTLimbs::LimbVector<2, CountingAllocator> limbs;
+        limbs.push_back(1);
+        limbs.push_back(2);
+        assert( CountingAllocator::blocks == 0 );
+        limbs.push_back(3);
+        VTLimbs::LimbVector<2, CountingAllocator> copy(limbs);
+        assert( CountingAllocator::blocks == 2 && copy == limbs );
+    }
+    assert( CountingAllocator::blocks == 0 );
+
+    // scratch frames are released in stack order
+    {
+        VTLimbs::ScratchFrame outer;
+        VTLimbs::limb_t* first = outer.alloc(10);
+        {
+            VTLimbs::ScratchFrame inner;
+            assert( inner.alloc(10) == first + 10 );
+        }
+        VTLimbs::ScratchFrame next;
+        assert( next.alloc(5) == first + 10 );
+    }
+
+    test_threads(70000);
+
+    test_products();
+
+    test_words(1);
+    test_words(13);
+    test_words(200);
+
+    test_streams(5);
+    test_streams(150000);
+
+    test_files(1);
+    test_files(100000);
+
+    test_bits(1);
+    test_bits(200);
+
+    test_gcd(8);
+    test_gcd(3000);
+
+    test_roots(5);
+    test_roots(20000);
+
+    test_stats();
+
+    test_batch(13, 1);
+    test_batch(21, 3);
+    test_batch(9, 8);
+
+    test_fixed_bignum<64>(1);
+    test_fixed_bignum<100>(2);
+    test_fixed_bignum<256>(3);
+    test_fixed_bignum<512>(4);
+#if defined(VT_HAS_CONSTEXPR)
+    {
+        constexpr VTFixedBignum<128> two_64 = VTFixedBignum<128>::fromString("10000000000000000", -1, VTBignum::Base_16);
+        static_assert( !(two_64 * two_64), "product wraps around modulo 2^128" );
+        static_assert( (two_64 - VTFixedBignum<128>(1)).limb(0) == VTLimbs::LIMB_MAX, "subtraction borrows" );
+        static_assert( two_64.full_product(two_64).limb(2) == 1, "full product does not wrap" );
+    }
+#endif
+
+    // expiring operands are reused by the operators
+    VTBignum chain = large_copy * large_copy + large_copy - large_copy * large_copy;
+    assert( chain == large_copy );
+    assert( VTBignum::fromInt(5) - large_copy * VTBignum::fromInt(2) == -(large_copy + large_copy - VTBignum::fromInt(5)) );
+    // products are accumulated straight into the destination
+    VTBignum acc = VTBignum::fromInt(5);
+    acc += large_copy * large_copy;
+    acc -= large_copy * VTBignum::fromInt(3);
+    acc -= large_copy * large_copy;
+    assert( acc == VTBignum::fromInt(5) - VTBignum(large_copy * VTBignum::fromInt(3)) );
+    acc -= acc * acc;
+    assert( acc == -(large_copy * VTBignum::fromInt(3) - VTBignum::fromInt(5)) * (large_copy * VTBignum::fromInt(3) - VTBignum::fromInt(4)) );
+    assert( large_copy * large_copy + large_copy * large_copy == large_copy * large_copy * VTBignum::fromInt(2) );
+
+#if defined(VT_HAS_RVALUE_REFERENCES)
+    VTBignum moved_to(std::move(chain));
+    assert( moved_to == large_copy && !chain );
+    chain = std::move(moved_to);
+    assert( chain == large_copy && !moved_to );
+#endif
+
+    // divide and conquer radix conversion against limb chunks only
+    VTBignum long_number = random_bignum(30000, 9, 1);
+    std::string long_string = long_number.toString();
+    VTLimbs::Thresholds saved_str = VTLimbs::thresholds;
+    VTLimbs::thresholds.str_dc = 1 << 30;
+    assert( long_number.toString() == long_string );
+    assert( VTBignum::fromString(long_string.c_str()) == long_number );
+    std::string base7 = long_number.toString(7);
+    VTLimbs::thresholds = saved_str;
+    assert( long_number.toString(7) == base7 );
+    assert( VTBignum::fromString(long_string.c_str(), static_cast<int>(long_string.size())) == long_number );
+
     int d = 100000;
     printf("%d\n", d);
     printf("base 256: %s\n", VTBignum::fromInt(d).toString(256).c_str());
@@ -177,13 +1049,6 @@ int main(int argc, char** argv)
     printf("base  16: %s\n", VTBignum::fromInt(d).toString(16).c_str());
     printf("base  25: %s\n", VTBignum::fromInt(d).toString(35).c_str());
     printf("All good\n");
-    
-    
-
-    long long fact = 1000;
-    VTBignum factbig = factorial(fact);
-    printf("Factorial %lld size: %d\n", fact, factbig.size());
 
-    getchar();
     return 0;
 }
\ No newline at end of file